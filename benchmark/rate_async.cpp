@@ -0,0 +1,179 @@
+#include <iostream>
+#include <iomanip>
+#include <string>
+#include <vector>
+#include <chrono>
+#include <algorithm>
+#include <cstddef>
+#include <cstdint>
+#include <md_rng.h>
+
+// benchmark of the asynchronous generator
+// ---------------------------------------
+// consumer throughput : ns per variate of a consumer drawing uniform
+//                       variates as fast as it can, by scalar calls or
+//                       by bulk calls into blocks of 4096 variates, from
+//                       an async generator with each consumer policy and,
+//                       for reference, from a generator called inline
+// consumer latency    : percentiles of the time of single scalar calls of
+//                       a consumer doing some work between the calls, at
+//                       a rate the producer sustains
+// producer throughput : variates produced per second by the producer
+//                       while the consumer drains the ring in bulk, and
+//                       the stalls of both sides of a paced run
+// each async generator is drawn from once before it is timed, as the
+// first call waits for the producer to create the uniform stream
+
+typedef std::chrono::steady_clock timer;
+
+const std::size_t num_particles = 131072;
+const std::size_t num_blocks    = 16;
+const std::size_t block_size    = 4096;
+
+const std::vector<md::backpressure> policies = {
+  md::backpressure::spin, md::backpressure::yield, md::backpressure::sleep};
+
+const std::vector<std::string> policy_names = {"spin", "yield", "sleep"};
+
+double
+elapsed_ns(const timer::time_point start, const timer::time_point end)
+{ return std::chrono::duration<double, std::nano>(end - start).count(); }
+
+// work of the paced consumer between its calls, which the compiler
+// cannot remove as its result is returned
+double
+consumer_work(double x, const std::size_t iterations)
+{
+  for (std::size_t k = 0; k < iterations; k++) {
+    x = x * 0.999 + 0.001;
+  }
+  return x;
+}
+
+template <typename Rng>
+double
+calc_scalar_rate(Rng& r, const std::size_t samples, double& sum)
+{
+  const timer::time_point start = timer::now();
+  for (std::size_t k = 0; k < samples; k++) {
+    sum += r.uniform();
+  }
+  return elapsed_ns(start, timer::now()) / samples;
+}
+
+template <typename Rng>
+double
+calc_bulk_rate(Rng& r, const std::size_t samples, double& sum)
+{
+  std::vector<double> buf(4096);
+  const timer::time_point start = timer::now();
+  for (std::size_t k = 0; k < samples; k += buf.size()) {
+    r.fill_uniform(buf.data(), buf.size());
+    sum += buf[0];
+  }
+  return elapsed_ns(start, timer::now()) / samples;
+}
+
+// latencies of single scalar calls of a paced consumer, sorted
+template <typename Rng>
+std::vector<double>
+calc_latencies(Rng& r, const std::size_t samples, const std::size_t work, double& sum)
+{
+  std::vector<double> latency(samples);
+  double x = 0.5;
+  for (std::size_t k = 0; k < samples; k++) {
+    const timer::time_point start = timer::now();
+    const double u = r.uniform();
+    latency[k] = elapsed_ns(start, timer::now());
+    x = consumer_work(x + u, work);
+  }
+  sum += x;
+  std::sort(latency.begin(), latency.end());
+  return latency;
+}
+
+void
+print_latencies(const std::string& name, const std::vector<double>& latency)
+{
+  auto at = [&latency](const double q) {
+    return latency[static_cast<std::size_t>(q * (latency.size() - 1))];
+  };
+  std::cout << std::left << std::setw(16) << name << std::right << std::fixed
+            << std::setprecision(0)
+            << std::setw(10) << at(0.5)
+            << std::setw(10) << at(0.99)
+            << std::setw(10) << at(0.999)
+            << std::setw(10) << at(0.9999)
+            << std::setw(12) << latency.back() << "\n";
+  std::cout << std::defaultfloat;
+  return;
+}
+
+int
+main()
+{
+  const std::size_t samples         = 1 << 26;
+  const std::size_t latency_samples = 1 << 22;
+  const std::size_t work            = 100;
+  double sum = 0;
+
+  std::cout << "consumer throughput (ns per uniform variate)\n";
+  std::cout << std::left << std::setw(16) << "generator"
+            << std::right << std::setw(10) << "scalar" << std::setw(10) << "bulk" << "\n";
+  {
+    md::rng r(1234, num_particles);
+    const double scalar = calc_scalar_rate(r, samples, sum);
+    const double bulk   = calc_bulk_rate(r, samples, sum);
+    std::cout << std::left << std::setw(16) << "inline" << std::right << std::fixed
+              << std::setprecision(2) << std::setw(10) << scalar << std::setw(10) << bulk
+              << std::defaultfloat << "\n";
+  }
+  for (std::size_t p = 0; p < policies.size(); p++) {
+    md::async_rng a(1234, num_particles, 0.1, num_blocks, block_size, policies[p]);
+    sum += a.uniform();
+    const double scalar = calc_scalar_rate(a, samples, sum);
+    const double bulk   = calc_bulk_rate(a, samples, sum);
+    std::cout << std::left << std::setw(16) << "async " + policy_names[p] << std::right
+              << std::fixed << std::setprecision(2) << std::setw(10) << scalar
+              << std::setw(10) << bulk << std::defaultfloat << "\n";
+  }
+
+  std::cout << "\nconsumer latency (ns per scalar call, " << work
+            << " iterations of work between calls)\n";
+  std::cout << std::left << std::setw(16) << "generator" << std::right
+            << std::setw(10) << "p50" << std::setw(10) << "p99" << std::setw(10) << "p99.9"
+            << std::setw(10) << "p99.99" << std::setw(12) << "max" << "\n";
+  {
+    md::rng r(1234, num_particles);
+    print_latencies("inline", calc_latencies(r, latency_samples, work, sum));
+  }
+  for (std::size_t p = 0; p < policies.size(); p++) {
+    md::async_rng a(1234, num_particles, 0.1, num_blocks, block_size, policies[p]);
+    sum += a.uniform();
+    print_latencies("async " + policy_names[p],
+                    calc_latencies(a, latency_samples, work, sum));
+  }
+
+  std::cout << "\nproducer throughput (variates per second) and stalls\n";
+  std::cout << std::left << std::setw(16) << "producer" << std::right
+            << std::setw(14) << "rate" << std::setw(16) << "consumer stalls"
+            << std::setw(16) << "producer stalls" << "\n";
+  for (std::size_t p = 0; p < policies.size(); p++) {
+    md::async_rng a(1234, num_particles, 0.1, num_blocks, block_size,
+                    md::backpressure::yield, policies[p]);
+    sum += a.uniform();
+    const std::uint64_t blocks = a.blocks_produced();
+    const timer::time_point start = timer::now();
+    calc_bulk_rate(a, samples, sum);
+    const double seconds = elapsed_ns(start, timer::now()) * 1e-9;
+    const double rate = (a.blocks_produced() - blocks) * block_size / seconds;
+    calc_latencies(a, latency_samples, work, sum);
+    std::cout << std::left << std::setw(16) << "async " + policy_names[p] << std::right
+              << std::setw(14) << std::setprecision(4) << rate
+              << std::setw(16) << a.consumer_stalls()
+              << std::setw(16) << a.producer_stalls() << "\n";
+  }
+
+  std::cout << "\nchecksum " << sum << "\n";
+  return 0;
+}
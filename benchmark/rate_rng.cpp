@@ -0,0 +1,886 @@
+#include <iostream>
+#include <fstream>
+#include <sstream>
+#include <string>
+#include <vector>
+#include <memory>
+#include <random>
+#include <thread>
+#include <chrono>
+#include <cctype>
+#include <cstddef>
+#include <cstdint>
+#include <cstdlib>
+#include <algorithm>
+#include <stdexcept>
+#include <md_rng.h>
+#ifdef MD_BENCH_GSL
+#include <gsl/gsl_rng.h>
+#include <gsl/gsl_randist.h>
+#endif
+
+// benchmark harness
+// -----------------
+// every combination of the swept generators, distributions, API styles,
+// particle counts and thread counts is timed by a monotonic clock over
+// warmup passes, which are discarded, and repeated passes, of which the
+// median, extremes and median absolute deviation are reported in ns per
+// variate, and in cycles per variate at the nominal CPU frequency; the
+// results are printed as CSV or JSON, see usage()
+
+// distributions, where a mixed variate is a triplet of a uniform, a
+// normal and an exponential variate, and a construct variate is one
+// generator constructed in the respective way
+enum class dist {uniform, normal, normal_boxm, exp, u64, mixed,
+                 construct_standard, construct_fast, construct_template};
+
+// API styles: scalar calls, bulk calls into a block, and the
+// deterministic multi-threaded bulk calls filling the whole array
+enum class api {scalar, bulk, parallel};
+
+const std::vector<std::string> dist_names = {
+  "uniform", "normal", "normal_boxm", "exponential", "uint64", "mixed",
+  "construct_standard", "construct_fast", "construct_template"};
+
+const std::vector<std::string> api_names = {"scalar", "bulk", "parallel"};
+
+// variates per block of the bulk calls
+const std::size_t bulk_block = 4096;
+
+// settings of a benchmark run
+struct settings
+{
+  std::size_t              samples   = 1 << 24;
+  std::size_t              instances = 10;
+  unsigned                 warmup    = 1;
+  unsigned                 reps      = 5;
+  unsigned long            seed      = 1234;
+  double                   ghz       = 0;
+  std::string              format    = "csv";
+  std::size_t              prefetch  = 0;
+  std::size_t              depth     = 1;
+  std::vector<std::string> rngs;
+  std::vector<dist>        dists;
+  std::vector<api>         apis;
+  std::vector<std::size_t> particles;
+  std::vector<unsigned>    threads;
+};
+
+// a single benchmark case and the statistics of its passes
+struct result
+{
+  std::string rng;
+  dist        d;
+  api         a;
+  std::size_t particles;
+  unsigned    threads;
+  std::size_t samples;
+  double      median_ns;
+  double      min_ns;
+  double      max_ns;
+  double      mad_ns;
+  double      mean;
+};
+
+// sum of n variates drawn by scalar calls
+template <typename Draw>
+double
+scalar_loop(const std::size_t n, Draw draw)
+{
+  double sum = 0;
+  for (std::size_t i = 0; i < n; i++) {
+    sum += draw();
+  }
+  return sum;
+}
+
+// sum of n variates written block by block to buf by bulk calls
+template <typename T, typename Fill>
+double
+bulk_loop(std::vector<T>& buf, const std::size_t n, Fill fill)
+{
+  double sum = 0;
+  for (std::size_t i = 0; i < n; i += buf.size()) {
+    const std::size_t m = std::min(buf.size(), n - i);
+    fill(buf.data(), m);
+    for (std::size_t k = 0; k < m; k++) {
+      sum += static_cast<double>(buf[k]);
+    }
+  }
+  return sum;
+}
+
+// scale of a 64-bit integer to [0,1), so that sums stay finite
+const double u64_scale = 1. / 18446744073709551616.;
+
+// molecular dice generator Rng with a given number of particles
+template <typename Rng>
+class md_bench
+{
+public:
+  typedef typename Rng::real_type real_type;
+
+  md_bench(const unsigned long seed,
+           const std::size_t   num,
+           const std::size_t   prefetch,
+           const std::size_t   depth)
+  : m_rng(seed, num),
+    m_seed(seed),
+    m_num(num),
+    m_buf(bulk_block),
+    m_buf2(bulk_block),
+    m_buf3(bulk_block),
+    m_bits(bulk_block)
+  {
+    m_rng.set_prefetch_distance(prefetch);
+    m_rng.set_buffer_depth(depth);
+  }
+
+  static bool
+  supports(const dist d, const api a)
+  {
+    switch(d)
+    {
+      case dist::normal_boxm :
+        return false;
+      case dist::uniform :
+      case dist::normal  :
+      case dist::exp     :
+        return true;
+      case dist::u64   :
+      case dist::mixed :
+        return a != api::parallel;
+      default :
+        return a == api::scalar;
+    }
+  }
+
+  static bool
+  sweeps_particles()
+  { return true; }
+
+  double
+  run(const dist d, const api a, const std::size_t n)
+  {
+    Rng& r = m_rng;
+    if (a == api::scalar) {
+      switch(d)
+      {
+        case dist::uniform :
+          return scalar_loop(n, [&r]() { return r.uniform(); });
+        case dist::normal :
+          return scalar_loop(n, [&r]() { return r.normal(); });
+        case dist::exp :
+          return scalar_loop(n, [&r]() { return r.exp(); });
+        case dist::u64 :
+          return scalar_loop(n, [&r]() { return r() * u64_scale; });
+        case dist::mixed :
+          return scalar_loop(n, [&r]() {
+            const real_type u = r.uniform();
+            const real_type g = r.normal();
+            return u + g + r.exp();
+          });
+        case dist::construct_standard :
+        case dist::construct_fast :
+        case dist::construct_template :
+          return construct(d, n);
+        default :
+          return 0;
+      }
+    }
+    switch(d)
+    {
+      case dist::uniform :
+        return bulk_loop(m_buf, n, [&r](real_type* out, std::size_t m) { r.fill_uniform(out, m); });
+      case dist::normal :
+        return bulk_loop(m_buf, n, [&r](real_type* out, std::size_t m) { r.fill_normal(out, m); });
+      case dist::exp :
+        return bulk_loop(m_buf, n, [&r](real_type* out, std::size_t m) { r.fill_exp(out, m); });
+      case dist::u64 :
+        return u64_scale * bulk_loop(m_bits, n, [&r](std::uint64_t* out, std::size_t m) { r.fill_u64(out, m); });
+      case dist::mixed :
+        return bulk_loop(m_buf, n, [&](real_type* out, std::size_t m) {
+          r.fill_mixed(out, m_buf2.data(), m_buf3.data(), m);
+          for (std::size_t k = 0; k < m; k++) {
+            out[k] += m_buf2[k] + m_buf3[k];
+          }
+        });
+      default :
+        return 0;
+    }
+  }
+
+  // deterministic multi-threaded bulk call filling out, including the
+  // construction of the generator of each chunk
+  double
+  run_parallel(const dist d, std::vector<real_type>& out, const unsigned threads)
+  {
+    const std::size_t n     = out.size();
+    const std::size_t chunk = 1 << 24;
+    switch(d)
+    {
+      case dist::uniform : md::fill_uniform_parallel<Rng>(out.data(), n, m_seed, threads, chunk, m_num); break;
+      case dist::normal  : md::fill_normal_parallel<Rng>(out.data(), n, m_seed, threads, chunk, m_num); break;
+      case dist::exp     : md::fill_exp_parallel<Rng>(out.data(), n, m_seed, threads, chunk, m_num); break;
+      default            : break;
+    }
+    double sum = 0;
+    for (std::size_t k = 0; k < n; k++) {
+      sum += out[k];
+    }
+    return sum;
+  }
+
+private:
+  // construct n generators, drawing a number from each so that the
+  // construction isn't optimized away
+  double
+  construct(const dist d, const std::size_t n)
+  {
+    double sum = 0;
+    for (std::size_t i = 0; i < n; i++) {
+      const unsigned long s = m_seed + i + 1;
+      switch(d)
+      {
+        case dist::construct_standard : sum += Rng(s, m_num).normal(); break;
+        case dist::construct_fast     : sum += Rng(md::fast_start, s, m_num).normal(); break;
+        case dist::construct_template : sum += Rng(m_rng, s).normal(); break;
+        default                       : break;
+      }
+    }
+    return sum;
+  }
+
+  Rng                        m_rng;
+  unsigned long              m_seed;
+  std::size_t                m_num;
+  std::vector<real_type>     m_buf;
+  std::vector<real_type>     m_buf2;
+  std::vector<real_type>     m_buf3;
+  std::vector<std::uint64_t> m_bits;
+};
+
+// C++ standard library Mersenne twister with the standard distributions
+class cpp_bench
+{
+public:
+  typedef double real_type;
+
+  cpp_bench(const unsigned long seed, const std::size_t, const std::size_t, const std::size_t)
+  : m_rng(seed),
+    m_rng64(seed),
+    m_uniform(0., 1.),
+    m_normal(0., 1.),
+    m_exp(1.),
+    m_buf(bulk_block)
+  {}
+
+  static bool
+  supports(const dist d, const api a)
+  {
+    return a != api::parallel and
+           (d == dist::uniform or d == dist::normal or d == dist::exp or
+            d == dist::u64 or d == dist::mixed);
+  }
+
+  static bool
+  sweeps_particles()
+  { return false; }
+
+  double
+  draw(const dist d)
+  {
+    switch(d)
+    {
+      case dist::uniform : return m_uniform(m_rng);
+      case dist::normal  : return m_normal(m_rng);
+      case dist::exp     : return m_exp(m_rng);
+      case dist::u64     : return m_rng64() * u64_scale;
+      case dist::mixed   : {
+        const double u = m_uniform(m_rng);
+        const double g = m_normal(m_rng);
+        return u + g + m_exp(m_rng);
+      }
+      default : return 0;
+    }
+  }
+
+  double
+  run(const dist d, const api a, const std::size_t n)
+  {
+    // the distribution is selected outside the loops, so that
+    // each loop calls a single inlined distribution
+    switch(d)
+    {
+      case dist::uniform : return loop<dist::uniform>(a, n);
+      case dist::normal  : return loop<dist::normal>(a, n);
+      case dist::exp     : return loop<dist::exp>(a, n);
+      case dist::u64     : return loop<dist::u64>(a, n);
+      case dist::mixed   : return loop<dist::mixed>(a, n);
+      default            : return 0;
+    }
+  }
+
+  double
+  run_parallel(const dist, std::vector<real_type>&, const unsigned)
+  { return 0; }
+
+private:
+  template <dist D>
+  double
+  loop(const api a, const std::size_t n)
+  {
+    if (a == api::scalar) {
+      return scalar_loop(n, [this]() { return draw(D); });
+    }
+    return bulk_loop(m_buf, n, [this](double* out, std::size_t m) {
+      for (std::size_t k = 0; k < m; k++) {
+        out[k] = draw(D);
+      }
+    });
+  }
+
+  std::mt19937                           m_rng;
+  std::mt19937_64                        m_rng64;
+  std::uniform_real_distribution<double> m_uniform;
+  std::normal_distribution<double>       m_normal;
+  std::exponential_distribution<double>  m_exp;
+  std::vector<double>                    m_buf;
+};
+
+#ifdef MD_BENCH_GSL
+// GSL default generator with the GSL distributions, the normal variates
+// being sampled by the ziggurat and the Box-Muller method
+class gsl_bench
+{
+public:
+  typedef double real_type;
+
+  gsl_bench(const unsigned long seed, const std::size_t, const std::size_t, const std::size_t)
+  : m_buf(bulk_block)
+  {
+    gsl_rng_env_setup();
+    m_rng = gsl_rng_alloc(gsl_rng_default);
+    gsl_rng_set(m_rng, seed);
+  }
+
+  ~gsl_bench()
+  { gsl_rng_free(m_rng); }
+
+  gsl_bench(const gsl_bench&) = delete;
+  gsl_bench& operator=(const gsl_bench&) = delete;
+
+  static bool
+  supports(const dist d, const api a)
+  {
+    return a != api::parallel and
+           (d == dist::uniform or d == dist::normal or d == dist::normal_boxm or
+            d == dist::exp or d == dist::u64 or d == dist::mixed);
+  }
+
+  static bool
+  sweeps_particles()
+  { return false; }
+
+  double
+  draw(const dist d)
+  {
+    switch(d)
+    {
+      case dist::uniform     : return gsl_rng_uniform(m_rng);
+      case dist::normal      : return gsl_ran_gaussian_ziggurat(m_rng, 1.);
+      case dist::normal_boxm : return gsl_ran_gaussian(m_rng, 1.);
+      case dist::exp         : return gsl_ran_exponential(m_rng, 1.);
+      case dist::u64         : {
+        // the default generator yields 32 random bits per call
+        const std::uint64_t hi = gsl_rng_get(m_rng);
+        return ((hi << 32) | gsl_rng_get(m_rng)) * u64_scale;
+      }
+      case dist::mixed : {
+        const double u = gsl_rng_uniform(m_rng);
+        const double g = gsl_ran_gaussian_ziggurat(m_rng, 1.);
+        return u + g + gsl_ran_exponential(m_rng, 1.);
+      }
+      default : return 0;
+    }
+  }
+
+  double
+  run(const dist d, const api a, const std::size_t n)
+  {
+    switch(d)
+    {
+      case dist::uniform     : return loop<dist::uniform>(a, n);
+      case dist::normal      : return loop<dist::normal>(a, n);
+      case dist::normal_boxm : return loop<dist::normal_boxm>(a, n);
+      case dist::exp         : return loop<dist::exp>(a, n);
+      case dist::u64         : return loop<dist::u64>(a, n);
+      case dist::mixed       : return loop<dist::mixed>(a, n);
+      default                : return 0;
+    }
+  }
+
+  double
+  run_parallel(const dist, std::vector<real_type>&, const unsigned)
+  { return 0; }
+
+private:
+  template <dist D>
+  double
+  loop(const api a, const std::size_t n)
+  {
+    if (a == api::scalar) {
+      return scalar_loop(n, [this]() { return draw(D); });
+    }
+    return bulk_loop(m_buf, n, [this](double* out, std::size_t m) {
+      for (std::size_t k = 0; k < m; k++) {
+        out[k] = draw(D);
+      }
+    });
+  }
+
+  gsl_rng*            m_rng;
+  std::vector<double> m_buf;
+};
+#endif
+
+// one timed pass in seconds: each thread draws its share of the
+// samples from its own generator; the sum of all variates is
+// stored in sum so that the compiler doesn't remove the sampling
+template <typename Bench>
+double
+timed_pass(std::vector<std::unique_ptr<Bench>>& gens,
+           const dist                            d,
+           const api                             a,
+           const std::size_t                     samples,
+           double&                               sum)
+{
+  const std::size_t   threads = gens.size();
+  std::vector<double> sums(threads, 0.);
+  auto work = [&](const std::size_t t) {
+    const std::size_t share = samples / threads + (t < samples % threads);
+    sums[t] = gens[t]->run(d, a, share);
+  };
+
+  const auto start = std::chrono::steady_clock::now();
+  std::vector<std::thread> pool;
+  for (std::size_t t = 1; t < threads; t++) {
+    pool.emplace_back(work, t);
+  }
+  work(0);
+  for (std::size_t t = 0; t < pool.size(); t++) {
+    pool[t].join();
+  }
+  const auto end = std::chrono::steady_clock::now();
+
+  sum = 0;
+  for (std::size_t t = 0; t < threads; t++) {
+    sum += sums[t];
+  }
+  return std::chrono::duration<double>(end - start).count();
+}
+
+// one timed pass in seconds of the multi-threaded bulk calls filling
+// an array of all samples, which is allocated and touched beforehand
+template <typename Bench>
+double
+timed_parallel_pass(Bench&            gen,
+                    const dist        d,
+                    const std::size_t samples,
+                    const unsigned    threads,
+                    double&           sum)
+{
+  std::vector<typename Bench::real_type> out(samples, 0);
+  const auto start = std::chrono::steady_clock::now();
+  sum = gen.run_parallel(d, out, threads);
+  const auto end = std::chrono::steady_clock::now();
+  return std::chrono::duration<double>(end - start).count();
+}
+
+// median of a non-empty list of values
+double
+median(std::vector<double> x)
+{
+  std::sort(x.begin(), x.end());
+  const std::size_t k = x.size() / 2;
+  return (x.size() % 2) ? x[k] : 0.5 * (x[k - 1] + x[k]);
+}
+
+// time one case of the generator Bench over the warmup and measured
+// passes, the generators being constructed before the first pass
+template <typename Bench>
+result
+run_case(const settings&    s,
+         const std::string& rng_name,
+         const dist         d,
+         const api          a,
+         const std::size_t  num,
+         const unsigned     threads)
+{
+  const bool construct = (d == dist::construct_standard or
+                          d == dist::construct_fast or
+                          d == dist::construct_template);
+  const std::size_t samples = construct ? s.instances : s.samples;
+
+  // the parallel calls construct a generator per chunk themselves
+  const std::size_t num_gens = (a == api::parallel) ? 1 : threads;
+  std::vector<std::unique_ptr<Bench>> gens;
+  for (std::size_t t = 0; t < num_gens; t++) {
+    gens.emplace_back(new Bench(md::derive_seed(s.seed, t), num, s.prefetch, s.depth));
+  }
+
+  std::vector<double> times;
+  double sum = 0;
+  for (unsigned p = 0; p < s.warmup + s.reps; p++) {
+    const double t = (a == api::parallel) ?
+                     timed_parallel_pass(*gens[0], d, samples, threads, sum) :
+                     timed_pass(gens, d, a, samples, sum);
+    if (p >= s.warmup) {
+      times.push_back(1e9 * t / samples);
+    }
+  }
+
+  const double med = median(times);
+  std::vector<double> dev(times.size());
+  for (std::size_t k = 0; k < times.size(); k++) {
+    dev[k] = std::abs(times[k] - med);
+  }
+  result res;
+  res.rng       = rng_name;
+  res.d         = d;
+  res.a         = a;
+  res.particles = Bench::sweeps_particles() ? num : 0;
+  res.threads   = threads;
+  res.samples   = samples;
+  res.median_ns = med;
+  res.min_ns    = *std::min_element(times.begin(), times.end());
+  res.max_ns    = *std::max_element(times.begin(), times.end());
+  res.mad_ns    = median(dev);
+  res.mean      = sum / samples;
+  return res;
+}
+
+// run all cases of the generator Bench selected by the settings,
+// timing generators without a particle system only once
+template <typename Bench>
+void
+run_cases(const settings&      s,
+          const std::string&   rng_name,
+          std::vector<result>& results)
+{
+  const std::size_t num_counts = Bench::sweeps_particles() ? s.particles.size() : 1;
+  for (std::size_t k = 0; k < num_counts; k++) {
+    for (dist d : s.dists) {
+      for (api a : s.apis) {
+        if (not Bench::supports(d, a)) {
+          continue;
+        }
+        for (unsigned threads : s.threads) {
+          results.push_back(run_case<Bench>(s, rng_name, d, a, s.particles[k], threads));
+        }
+      }
+    }
+  }
+  return;
+}
+
+// nominal CPU frequency in GHz: the base frequency reported by cpufreq,
+// else the one in the model name, such as "@ 2.60GHz", or 0 if neither
+// is available; the "cpu MHz" of /proc/cpuinfo is not used, as it is the
+// current frequency, which varies with load and turbo
+double
+read_cpu_ghz()
+{
+  std::ifstream base("/sys/devices/system/cpu/cpu0/cpufreq/base_frequency");
+  double khz = 0;
+  if (base >> khz and khz > 0) {
+    return khz / 1e6;
+  }
+  std::ifstream in("/proc/cpuinfo");
+  std::string line;
+  while (std::getline(in, line)) {
+    if (line.compare(0, 10, "model name") == 0) {
+      const std::size_t unit = line.rfind("GHz");
+      if (unit == std::string::npos) {
+        return 0;
+      }
+      std::size_t begin = unit;
+      while (begin > 0 and
+             (std::isdigit(static_cast<unsigned char>(line[begin - 1])) or line[begin - 1] == '.')) {
+        --begin;
+      }
+      return std::atof(line.substr(begin, unit - begin).c_str());
+    }
+  }
+  return 0;
+}
+
+// output of the results
+// --------------------
+
+void
+print_csv(std::ostream& out, const settings& s, const std::vector<result>& results)
+{
+  out << "rng,distribution,api,particles,threads,samples,reps,"
+      << "median_ns,min_ns,max_ns,mad_ns,rate,cycles,mean\n";
+  out << std::scientific;
+  for (const result& r : results) {
+    out << r.rng << ","
+        << dist_names[int(r.d)] << ","
+        << api_names[int(r.a)] << ","
+        << r.particles << ","
+        << r.threads << ","
+        << r.samples << ","
+        << s.reps << ","
+        << r.median_ns << ","
+        << r.min_ns << ","
+        << r.max_ns << ","
+        << r.mad_ns << ","
+        << 1e9 / r.median_ns << ","
+        << r.median_ns * s.ghz << ","
+        << r.mean << "\n";
+  }
+  out << std::defaultfloat;
+  return;
+}
+
+void
+print_json(std::ostream& out, const settings& s, const std::vector<result>& results)
+{
+  out << "{\n";
+  out << "  \"compiler\": \"" << __VERSION__ << "\",\n";
+  out << "  \"hardware_threads\": " << std::thread::hardware_concurrency() << ",\n";
+  out << "  \"cpu_ghz\": " << s.ghz << ",\n";
+  out << "  \"isa\": \"" << md::isa_name(md::active_isa()) << "\",\n";
+  out << "  \"warmup\": " << s.warmup << ",\n";
+  out << "  \"reps\": " << s.reps << ",\n";
+  out << "  \"prefetch\": " << s.prefetch << ",\n";
+  out << "  \"depth\": " << s.depth << ",\n";
+  out << "  \"results\": [";
+  out << std::scientific;
+  for (std::size_t k = 0; k < results.size(); k++) {
+    const result& r = results[k];
+    out << (k ? ",\n" : "\n");
+    out << "    {\"rng\": \"" << r.rng << "\""
+        << ", \"distribution\": \"" << dist_names[int(r.d)] << "\""
+        << ", \"api\": \"" << api_names[int(r.a)] << "\""
+        << ", \"particles\": " << r.particles
+        << ", \"threads\": " << r.threads
+        << ", \"samples\": " << r.samples
+        << ", \"median_ns\": " << r.median_ns
+        << ", \"min_ns\": " << r.min_ns
+        << ", \"max_ns\": " << r.max_ns
+        << ", \"mad_ns\": " << r.mad_ns
+        << ", \"rate\": " << 1e9 / r.median_ns
+        << ", \"cycles\": " << r.median_ns * s.ghz
+        << ", \"mean\": " << r.mean << "}";
+  }
+  out << std::defaultfloat;
+  out << "\n  ]\n}\n";
+  return;
+}
+
+// command line
+// ------------
+
+void
+usage(std::ostream& out)
+{
+  out <<
+    "usage: rate_rng [option=value ...]\n"
+    "  --rng=LIST        generators: molecular_dice, molecular_dice_float,\n"
+    "                    molecular_dice_tiled, molecular_dice_quaternion,\n"
+    "                    molecular_dice_fixed32, molecular_dice_fixed64,\n"
+    "                    molecular_dice_huge_pages,\n"
+    "                    cpp_mt19937"
+#ifdef MD_BENCH_GSL
+    ", gsl"
+#endif
+    "\n"
+    "  --dist=LIST       distributions: uniform, normal, normal_boxm,\n"
+    "                    exponential, uint64, mixed, construct_standard,\n"
+    "                    construct_fast, construct_template\n"
+    "  --api=LIST        API styles: scalar, bulk, parallel\n"
+    "  --particles=LIST  particle counts of the molecular dice generators\n"
+    "  --threads=LIST    thread counts\n"
+    "  --samples=N       variates per pass (default 16777216)\n"
+    "  --instances=N     generators constructed per pass (default 10)\n"
+    "  --warmup=N        discarded passes (default 1)\n"
+    "  --reps=N          measured passes (default 5)\n"
+    "  --seed=N          base seed (default 1234)\n"
+    "  --prefetch=K      pairs prefetched ahead by the molecular dice\n"
+    "                    generators, except in parallel calls (default 0)\n"
+    "  --depth=K         collisions per refill of the buffers of the scalar\n"
+    "                    calls of the molecular dice generators (default 1)\n"
+    "  --ghz=F           CPU frequency for cycles per variate (default:\n"
+    "                    the nominal one reported by the kernel, if any)\n"
+    "  --format=csv|json output format (default csv)\n"
+    "LIST is comma-separated.\n";
+  return;
+}
+
+std::vector<std::string>
+split_list(const std::string& list)
+{
+  std::vector<std::string> items;
+  std::stringstream ss(list);
+  std::string item;
+  while (std::getline(ss, item, ',')) {
+    if (not item.empty()) {
+      items.push_back(item);
+    }
+  }
+  return items;
+}
+
+// index of a name in a list of names
+std::size_t
+find_name(const std::vector<std::string>& names, const std::string& name)
+{
+  const std::size_t k = std::find(names.begin(), names.end(), name) - names.begin();
+  if (k == names.size()) {
+    throw std::invalid_argument("unknown name " + name);
+  }
+  return k;
+}
+
+settings
+parse_settings(const int argc, char** argv)
+{
+  settings s;
+  s.rngs = {"molecular_dice", "molecular_dice_float", "cpp_mt19937"};
+#ifdef MD_BENCH_GSL
+  s.rngs.push_back("gsl");
+#endif
+  s.dists = {dist::uniform, dist::normal, dist::exp, dist::u64, dist::mixed,
+             dist::construct_standard, dist::construct_fast, dist::construct_template};
+  s.apis      = {api::scalar, api::bulk};
+  s.particles = {131072};
+  s.threads   = {1};
+
+  for (int i = 1; i < argc; i++) {
+    const std::string arg(argv[i]);
+    const std::size_t eq = arg.find('=');
+    if (arg.compare(0, 2, "--") != 0 or eq == std::string::npos) {
+      throw std::invalid_argument("malformed option " + arg);
+    }
+    const std::string key   = arg.substr(2, eq - 2);
+    const std::string value = arg.substr(eq + 1);
+    const std::vector<std::string> items = split_list(value);
+    if (key == "rng") {
+      s.rngs = items;
+    } else if (key == "dist") {
+      s.dists.clear();
+      for (const std::string& item : items) {
+        s.dists.push_back(static_cast<dist>(find_name(dist_names, item)));
+      }
+    } else if (key == "api") {
+      s.apis.clear();
+      for (const std::string& item : items) {
+        s.apis.push_back(static_cast<api>(find_name(api_names, item)));
+      }
+    } else if (key == "particles") {
+      s.particles.clear();
+      for (const std::string& item : items) {
+        s.particles.push_back(std::stoul(item));
+      }
+    } else if (key == "threads") {
+      s.threads.clear();
+      for (const std::string& item : items) {
+        s.threads.push_back(std::stoul(item));
+      }
+    } else if (key == "samples") {
+      s.samples = static_cast<std::size_t>(std::stod(value));
+    } else if (key == "instances") {
+      s.instances = std::stoul(value);
+    } else if (key == "warmup") {
+      s.warmup = std::stoul(value);
+    } else if (key == "reps") {
+      s.reps = std::stoul(value);
+    } else if (key == "seed") {
+      s.seed = std::stoul(value);
+    } else if (key == "prefetch") {
+      s.prefetch = std::stoul(value);
+    } else if (key == "depth") {
+      s.depth = std::stoul(value);
+    } else if (key == "ghz") {
+      s.ghz = std::stod(value);
+    } else if (key == "format") {
+      s.format = value;
+    } else {
+      throw std::invalid_argument("unknown option " + arg);
+    }
+  }
+
+  if (s.samples == 0 or s.instances == 0 or s.reps == 0 or
+      s.particles.empty() or s.threads.empty()) {
+    throw std::invalid_argument("use non-zero samples, instances and reps, and "
+                                "at least one particle and thread count");
+  }
+  for (unsigned threads : s.threads) {
+    if (threads == 0) {
+      throw std::invalid_argument("use non-zero thread counts");
+    }
+  }
+  if (s.format != "csv" and s.format != "json") {
+    throw std::invalid_argument("unknown format " + s.format);
+  }
+  if (s.ghz == 0) {
+    s.ghz = read_cpu_ghz();
+  }
+  return s;
+}
+
+int
+main(int argc, char** argv)
+{
+  settings s;
+  if (argc > 1 and std::string(argv[1]) == "--help") {
+    usage(std::cout);
+    return 0;
+  }
+  try {
+    s = parse_settings(argc, argv);
+  } catch (const std::exception& e) {
+    std::cerr << e.what() << "\n";
+    usage(std::cerr);
+    return 1;
+  }
+
+  std::vector<result> results;
+  for (const std::string& name : s.rngs) {
+    if (name == "molecular_dice") {
+      run_cases<md_bench<md::rng>>(s, name, results);
+    } else if (name == "molecular_dice_float") {
+      run_cases<md_bench<md::rng_float>>(s, name, results);
+    } else if (name == "molecular_dice_tiled") {
+      run_cases<md_bench<md::rng_tiled>>(s, name, results);
+    } else if (name == "molecular_dice_quaternion") {
+      run_cases<md_bench<md::rng_quaternion>>(s, name, results);
+    } else if (name == "molecular_dice_fixed32") {
+      run_cases<md_bench<md::rng_fixed32>>(s, name, results);
+    } else if (name == "molecular_dice_fixed64") {
+      run_cases<md_bench<md::rng_fixed64>>(s, name, results);
+    } else if (name == "molecular_dice_huge_pages") {
+      run_cases<md_bench<md::rng_huge_pages>>(s, name, results);
+    } else if (name == "cpp_mt19937") {
+      run_cases<cpp_bench>(s, name, results);
+#ifdef MD_BENCH_GSL
+    } else if (name == "gsl") {
+      run_cases<gsl_bench>(s, std::string("gsl_") + gsl_rng_default->name, results);
+#endif
+    } else {
+      std::cerr << "unknown generator " << name << "\n";
+      usage(std::cerr);
+      return 1;
+    }
+  }
+
+  if (s.format == "json") {
+    print_json(std::cout, s, results);
+  } else {
+    print_csv(std::cout, s, results);
+  }
+
+  return 0;
+}
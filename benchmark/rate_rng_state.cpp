@@ -0,0 +1,193 @@
+#include <iostream>
+#include <cstddef>
+#include <cstdint>
+#include <chrono>
+#include <random>
+#include <string>
+#include <vector>
+#include <cmath>
+#include <algorithm>
+#include <md_rng.h>
+
+// every state and path is timed by a monotonic clock over warmup passes,
+// which are discarded, and repeated passes, of which the median and the
+// median absolute deviation of the rate, in updates per second, are
+// reported with the extremes
+
+const unsigned warmup = 1;
+const unsigned reps   = 5;
+
+// paths through the particle system
+enum class path {sweep, pairs};
+
+template <typename State>
+std::string state_name();
+
+template <>
+std::string state_name<md::basic_rng_state<md::aos_layout>>() { return "aos"; }
+
+template <>
+std::string state_name<md::basic_rng_state<md::interleaved_layout>>() { return "interleaved"; }
+
+template <>
+std::string state_name<md::basic_rng_state<md::soa_layout>>() { return "soa"; }
+
+template <>
+std::string state_name<md::basic_rng_state<md::allocated_layout<md::aos_layout, md::huge_page_allocation>>>() { return "aos_huge"; }
+
+template <>
+std::string state_name<md::basic_rng_state<md::allocated_layout<md::aos_layout, md::arena_allocation>>>() { return "aos_arena"; }
+
+template <>
+std::string state_name<md::fixed_point_rng_state<std::uint32_t>>() { return "fixed32"; }
+
+template <>
+std::string state_name<md::fixed_point_rng_state<std::uint64_t>>() { return "fixed64"; }
+
+// median of a non-empty list of values
+double
+median(std::vector<double> x)
+{
+  std::sort(x.begin(), x.end());
+  const std::size_t k = x.size() / 2;
+  return (x.size() % 2) ? x[k] : 0.5 * (x[k - 1] + x[k]);
+}
+
+template <typename State, path P>
+void
+calc_state_update_rate(const std::size_t num,
+                       const std::size_t samples,
+                       unsigned long     seed)
+{
+  // setup equilibriated particle system
+  State s(num);
+  std::mt19937 xr(seed);
+  md::equilibriate_positions(s, xr);
+  md::equilibriate_velocities(s, xr);
+
+  // rotation matrix scaled as in the RNG, rotating by a quarter turn
+  md::rotation_matrix R = {0., -0.5, 0., 0.5, 0., 0., 0., 0., 0.5};
+
+  // pairs are selected as in the RNG: a strided sweep of first
+  // particles, each paired with the particle a fixed jump away
+  const std::size_t shift = 7;
+  const std::size_t jump  = num / 3 + 1;
+
+  // one pass of the given number of particle updates, where a sweep
+  // updates one position per particle and a pair collision updates both
+  // velocities and positions of two particles, with the updates compiled
+  // for the active instruction set; returns the rate in updates per second
+  double dt = 0.1;
+  std::size_t idx_a = 0;
+  auto timed_pass = [&](std::size_t& updates) {
+    const auto start = std::chrono::steady_clock::now();
+    updates = 0;
+    md::isa_dispatch([&]() {
+      while (updates < samples) {
+        switch(P)
+        {
+          case path::sweep :
+            s.update_all_pos(dt);
+            dt = -dt;
+            updates += num;
+            break;
+          case path::pairs :
+            for (std::size_t k = 0; k < num / 8; k++) {
+              idx_a += shift;
+              idx_a -= num * (idx_a >= num);
+              std::size_t idx_b = idx_a + jump;
+              idx_b -= num * (idx_b >= num);
+              s.update(R, idx_a, idx_b, true, dt);
+            }
+            updates += 2 * (num / 8);
+            break;
+          default :
+            break;
+        }
+      }
+    });
+    const auto end = std::chrono::steady_clock::now();
+    return updates / std::chrono::duration<double>(end - start).count();
+  };
+
+  std::vector<double> rates;
+  std::size_t updates = 0;
+  for (unsigned p = 0; p < warmup + reps; p++) {
+    const double rate = timed_pass(updates);
+    if (p >= warmup) {
+      rates.push_back(rate);
+    }
+  }
+  const double med = median(rates);
+  std::vector<double> dev(rates.size());
+  for (std::size_t k = 0; k < rates.size(); k++) {
+    dev[k] = std::abs(rates[k] - med);
+  }
+
+  // checksum of the final state so that the compiler
+  // doesn't remove the update loop during optimization
+  double checksum = 0;
+  for (std::size_t i = 0; i < num; i++) {
+    checksum += s.pos(i).x + s.vel(i).vx;
+  }
+
+  // print results
+  std::string path_name;
+  switch(P)
+  {
+    case path::sweep : path_name = "full_sweep"; break;
+    case path::pairs : path_name = "random_pairs"; break;
+    default          : break;
+  }
+  std::cout << std::scientific;
+  std::cout << state_name<State>() << ",";
+  std::cout << path_name << ",";
+  std::cout << static_cast<double>(num) << ",";
+  std::cout << med << ",";
+  std::cout << *std::min_element(rates.begin(), rates.end()) << ",";
+  std::cout << *std::max_element(rates.begin(), rates.end()) << ",";
+  std::cout << median(dev) << ",";
+  std::cout << checksum << ",";
+  std::cout << static_cast<double>(updates) << std::endl;
+  std::cout << std::defaultfloat;
+
+  return;
+}
+
+template <typename State>
+void
+calc_state_update_rates(const std::size_t num,
+                        const std::size_t samples,
+                        unsigned long     seed)
+{
+  calc_state_update_rate<State, path::sweep>(num, samples, seed);
+  calc_state_update_rate<State, path::pairs>(num, samples, seed);
+  return;
+}
+
+int
+main()
+{
+  unsigned long int seed    = 1234;
+  const std::size_t samples = 2e8;
+
+  std::cout << "state,path,particles,median_rate,min_rate,max_rate,mad_rate,checksum,updates" << std::endl;
+
+  for (std::size_t num : {std::size_t(4096), std::size_t(131072), std::size_t(2097152)}) {
+    calc_state_update_rates<md::basic_rng_state<md::aos_layout>>(num, samples, seed);
+    calc_state_update_rates<md::basic_rng_state<md::interleaved_layout>>(num, samples, seed);
+    calc_state_update_rates<md::basic_rng_state<md::soa_layout>>(num, samples, seed);
+    calc_state_update_rates<md::basic_rng_state<md::allocated_layout<md::aos_layout, md::huge_page_allocation>>>(num, samples, seed);
+    {
+      // the states are constructed in an arena, which holds the two
+      // arrays of 24 bytes per particle of one state at a time
+      md::arena region(64 * num);
+      md::arena_scope scope(region);
+      calc_state_update_rates<md::basic_rng_state<md::allocated_layout<md::aos_layout, md::arena_allocation>>>(num, samples, seed);
+    }
+    calc_state_update_rates<md::fixed_point_rng_state<std::uint32_t>>(num, samples, seed);
+    calc_state_update_rates<md::fixed_point_rng_state<std::uint64_t>>(num, samples, seed);
+  }
+
+  return 0;
+}
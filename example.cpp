@@ -1,4 +1,5 @@
 #include <iostream>
+#include <vector>
 #include <md_rng.h>
 
 int main()
@@ -15,5 +16,11 @@ int main()
   // generate an exponentially distributed random number
   std::cout << r.exp() << std::endl;
 
+  // fill an array with normally distributed random numbers,
+  // identical to those generated by successive r.normal() calls
+  std::vector<double> norms(1000);
+  r.fill_normal(norms.data(), norms.size());
+  std::cout << norms.back() << std::endl;
+
   return 0;
 }
@@ -0,0 +1,55 @@
+// Copyright (c) 2018 Santosh Ansumali @ JNCASR
+// See LICENSE
+
+#pragma once
+
+#include <cstddef>
+#include <cstdlib>
+#include <new>
+
+namespace md {
+
+// allocator for standard containers which places the first element
+// at an address that is a multiple of the given alignment
+template <typename T, std::size_t Align = 64>
+class aligned_allocator
+{
+public:
+  typedef T value_type;
+
+  template <typename U>
+  struct rebind
+  { typedef aligned_allocator<U, Align> other; };
+
+  aligned_allocator() = default;
+
+  template <typename U>
+  aligned_allocator(const aligned_allocator<U, Align>&)
+  {}
+
+  T*
+  allocate(const std::size_t n)
+  {
+    void* p = nullptr;
+    if (posix_memalign(&p, Align, n * sizeof(T)) != 0) {
+      throw std::bad_alloc();
+    }
+    return static_cast<T*>(p);
+  }
+
+  void
+  deallocate(T* p, const std::size_t)
+  { std::free(p); }
+};
+
+template <typename T, typename U, std::size_t Align>
+bool
+operator==(const aligned_allocator<T, Align>&, const aligned_allocator<U, Align>&)
+{ return true; }
+
+template <typename T, typename U, std::size_t Align>
+bool
+operator!=(const aligned_allocator<T, Align>&, const aligned_allocator<U, Align>&)
+{ return false; }
+
+} // namespace md
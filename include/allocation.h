@@ -0,0 +1,354 @@
+// Copyright (c) 2018 Santosh Ansumali @ JNCASR
+// See LICENSE
+
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <cstdio>
+#include <cstdlib>
+#include <atomic>
+#include <exception>
+#include <new>
+#include "aligned_allocator.h"
+
+// huge pages are mapped on POSIX systems; elsewhere, memory of whole
+// huge pages is allocated aligned to a huge page, without the advice
+#if defined(__unix__) || defined(__APPLE__)
+#define MD_RNG_HUGE_PAGES 1
+#include <sys/mman.h>
+#else
+#define MD_RNG_HUGE_PAGES 0
+#endif
+
+namespace md {
+
+// allocation policies
+// -------------------
+// the heap storages of particle_layout.h take the memory of their arrays
+// through an allocation policy, whose nested allocator template gives
+// the allocator of each array; a policy is chosen for a layout by
+// allocated_layout
+// aligned_allocation            : arrays aligned to cache lines, the
+//                                 default of all heap storages
+// huge_page_allocation          : arrays of at least a huge page on
+//                                 transparent huge pages, which cut the
+//                                 TLB misses of the random accesses of
+//                                 the collisions to large particle systems
+// explicit_huge_page_allocation : as huge_page_allocation, but on huge
+//                                 pages reserved by the system, see
+//                                 /proc/sys/vm/nr_hugepages, if any are
+//                                 left, and on transparent ones if not
+// arena_allocation              : arrays carved from the arena bound by
+//                                 an arena_scope, so that many generators
+//                                 share one region reserved in advance
+
+constexpr std::size_t huge_page_size = std::size_t(2) << 20;
+
+// bytes rounded up to whole huge pages
+inline std::size_t
+huge_page_bytes(const std::size_t bytes)
+{ return (bytes + huge_page_size - 1) / huge_page_size * huge_page_size; }
+
+// map anonymous memory of whole huge pages for bytes, aligned to a huge
+// page; it is taken from the reserved huge pages if reserved is set and
+// any are left, and is otherwise advised to be backed by transparent
+// huge pages, which the kernel may decline silently
+inline void*
+map_huge_pages(const std::size_t bytes, const bool reserved)
+{
+  const std::size_t size = huge_page_bytes(bytes);
+#if !MD_RNG_HUGE_PAGES
+  (void) reserved;
+  return aligned_allocator<char, huge_page_size>().allocate(size);
+#else
+#if defined(MAP_HUGETLB)
+  if (reserved) {
+    void* p = mmap(nullptr, size, PROT_READ | PROT_WRITE,
+                   MAP_PRIVATE | MAP_ANONYMOUS | MAP_HUGETLB, -1, 0);
+    if (p != MAP_FAILED) {
+      return p;
+    }
+  }
+#else
+  (void) reserved;
+#endif
+  // map one huge page more than needed and unmap the ends around the
+  // aligned region
+  void* q = mmap(nullptr, size + huge_page_size, PROT_READ | PROT_WRITE,
+                 MAP_PRIVATE | MAP_ANONYMOUS, -1, 0);
+  if (q == MAP_FAILED) {
+    throw std::bad_alloc();
+  }
+  const std::uintptr_t start   = reinterpret_cast<std::uintptr_t>(q);
+  const std::uintptr_t aligned = (start + huge_page_size - 1) / huge_page_size * huge_page_size;
+  char* p = reinterpret_cast<char*>(aligned);
+  if (aligned > start) {
+    munmap(q, aligned - start);
+  }
+  if (aligned - start < huge_page_size) {
+    munmap(p + size, huge_page_size - (aligned - start));
+  }
+#if defined(MADV_HUGEPAGE)
+  madvise(p, size, MADV_HUGEPAGE);
+#endif
+  return p;
+#endif
+}
+
+inline void
+unmap_huge_pages(void* p, const std::size_t bytes)
+{
+#if MD_RNG_HUGE_PAGES
+  munmap(p, huge_page_bytes(bytes));
+#else
+  aligned_allocator<char, huge_page_size>().deallocate(static_cast<char*>(p), bytes);
+#endif
+  return;
+}
+
+// allocator placing arrays of at least a huge page on huge pages, see
+// map_huge_pages, and smaller arrays as aligned_allocator does
+template <typename T, bool Reserved = false>
+class huge_page_allocator
+{
+public:
+  typedef T value_type;
+
+  template <typename U>
+  struct rebind
+  { typedef huge_page_allocator<U, Reserved> other; };
+
+  huge_page_allocator() = default;
+
+  template <typename U>
+  huge_page_allocator(const huge_page_allocator<U, Reserved>&)
+  {}
+
+  T*
+  allocate(const std::size_t n)
+  {
+    if (n * sizeof(T) < huge_page_size) {
+      return aligned_allocator<T, 64>().allocate(n);
+    }
+    return static_cast<T*>(map_huge_pages(n * sizeof(T), Reserved));
+  }
+
+  void
+  deallocate(T* p, const std::size_t n)
+  {
+    if (n * sizeof(T) < huge_page_size) {
+      aligned_allocator<T, 64>().deallocate(p, n);
+    } else {
+      unmap_huge_pages(p, n * sizeof(T));
+    }
+    return;
+  }
+};
+
+template <typename T, typename U, bool Reserved>
+bool
+operator==(const huge_page_allocator<T, Reserved>&, const huge_page_allocator<U, Reserved>&)
+{ return true; }
+
+template <typename T, typename U, bool Reserved>
+bool
+operator!=(const huge_page_allocator<T, Reserved>&, const huge_page_allocator<U, Reserved>&)
+{ return false; }
+
+// region of memory reserved in advance, on huge pages, from which
+// blocks aligned to cache lines are handed out by advancing an offset,
+// safely from several threads; a returned block is reused only if it is
+// the one handed out last, and the memory of the others is released as
+// a whole with the arena. the arena has to outlive all generators
+// allocated from it, i.e. all blocks have to be returned before it is
+// destroyed; an arena destroyed with blocks outstanding terminates the
+// program, in all builds, rather than leave the generators dangling
+class arena
+{
+public:
+  // reserve bytes of memory, from the reserved huge pages if reserved
+  // is set and any are left, see map_huge_pages
+  explicit arena(const std::size_t bytes, const bool reserved = false)
+  : m_data(static_cast<char*>(map_huge_pages(bytes, reserved))),
+    m_capacity(huge_page_bytes(bytes))
+  {}
+
+  arena(const arena&) = delete;
+  arena& operator=(const arena&) = delete;
+
+  ~arena()
+  {
+    if (blocks() != 0) {
+      std::fputs("md::arena destroyed before the generators allocated from it\n", stderr);
+      std::terminate();
+    }
+    unmap_huge_pages(m_data, m_capacity);
+  }
+
+  // block of bytes; throws std::bad_alloc once the arena is exhausted
+  void*
+  allocate(const std::size_t bytes)
+  {
+    const std::size_t size = (bytes + block_align - 1) / block_align * block_align;
+    std::size_t offset = m_used.load(std::memory_order_relaxed);
+    do {
+      if (size > m_capacity - offset) {
+        throw std::bad_alloc();
+      }
+    } while (not m_used.compare_exchange_weak(offset, offset + size,
+                                              std::memory_order_relaxed));
+    m_blocks.fetch_add(1, std::memory_order_relaxed);
+    return m_data + offset;
+  }
+
+  // return a block of bytes; its space is reused if no block was handed
+  // out after it, e.g. when a generator is resized right after it was
+  // allocated, and is left unused otherwise
+  void
+  deallocate(void* p, const std::size_t bytes)
+  {
+    const std::size_t size   = (bytes + block_align - 1) / block_align * block_align;
+    const std::size_t offset = static_cast<char*>(p) - m_data;
+    std::size_t end = offset + size;
+    m_used.compare_exchange_strong(end, offset, std::memory_order_relaxed);
+    m_blocks.fetch_sub(1, std::memory_order_relaxed);
+    return;
+  }
+
+  std::size_t
+  capacity() const
+  { return m_capacity; }
+
+  std::size_t
+  used() const
+  { return m_used.load(std::memory_order_relaxed); }
+
+  // number of blocks handed out and not returned
+  std::size_t
+  blocks() const
+  { return m_blocks.load(std::memory_order_relaxed); }
+
+private:
+  static constexpr std::size_t block_align = 64;
+
+  char*                    m_data;
+  const std::size_t        m_capacity;
+  std::atomic<std::size_t> m_used{0};
+  std::atomic<std::size_t> m_blocks{0};
+};
+
+// binds an arena to the calling thread for its lifetime; generators
+// with arena allocation constructed by the thread meanwhile take their
+// particle arrays from the arena, and keep doing so for the arrays they
+// reallocate later, e.g. when loading a snapshot of another size
+class arena_scope
+{
+public:
+  explicit arena_scope(arena& a)
+  : m_previous(current())
+  { current() = &a; }
+
+  arena_scope(const arena_scope&) = delete;
+  arena_scope& operator=(const arena_scope&) = delete;
+
+  ~arena_scope()
+  { current() = m_previous; }
+
+  // arena bound to the calling thread, nullptr if none
+  static arena*&
+  current()
+  {
+    static thread_local arena* bound = nullptr;
+    return bound;
+  }
+
+private:
+  arena* m_previous;
+};
+
+// allocator taking blocks from the arena bound to the thread which
+// constructs it, or, if none is bound, allocating as aligned_allocator
+// does
+template <typename T>
+class arena_allocator
+{
+public:
+  typedef T value_type;
+
+  template <typename U>
+  struct rebind
+  { typedef arena_allocator<U> other; };
+
+  arena_allocator()
+  : m_arena(arena_scope::current())
+  {}
+
+  template <typename U>
+  arena_allocator(const arena_allocator<U>& a)
+  : m_arena(a.bound_arena())
+  {}
+
+  T*
+  allocate(const std::size_t n)
+  {
+    if (m_arena == nullptr) {
+      return aligned_allocator<T, 64>().allocate(n);
+    }
+    return static_cast<T*>(m_arena->allocate(n * sizeof(T)));
+  }
+
+  void
+  deallocate(T* p, const std::size_t n)
+  {
+    if (m_arena == nullptr) {
+      aligned_allocator<T, 64>().deallocate(p, n);
+    } else {
+      m_arena->deallocate(p, n * sizeof(T));
+    }
+    return;
+  }
+
+  arena*
+  bound_arena() const
+  { return m_arena; }
+
+private:
+  arena* m_arena;
+};
+
+template <typename T, typename U>
+bool
+operator==(const arena_allocator<T>& a, const arena_allocator<U>& b)
+{ return a.bound_arena() == b.bound_arena(); }
+
+template <typename T, typename U>
+bool
+operator!=(const arena_allocator<T>& a, const arena_allocator<U>& b)
+{ return a.bound_arena() != b.bound_arena(); }
+
+struct aligned_allocation
+{
+  template <typename T>
+  using allocator = aligned_allocator<T, 64>;
+};
+
+struct huge_page_allocation
+{
+  template <typename T>
+  using allocator = huge_page_allocator<T, false>;
+};
+
+struct explicit_huge_page_allocation
+{
+  template <typename T>
+  using allocator = huge_page_allocator<T, true>;
+};
+
+struct arena_allocation
+{
+  template <typename T>
+  using allocator = arena_allocator<T>;
+};
+
+} // namespace md
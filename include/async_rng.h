@@ -0,0 +1,442 @@
+// Copyright (c) 2018 Santosh Ansumali @ JNCASR
+// See LICENSE
+
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <exception>
+#include <memory>
+#include <stdexcept>
+#include <thread>
+#include <vector>
+#include "aligned_allocator.h"
+#include "seed.h"
+#include "rng.h"
+
+namespace md {
+
+// lock-free single-producer/single-consumer ring of blocks
+// --------------------------------------------------------
+// a fixed number of blocks of a fixed number of values; the producer
+// writes the block at the head and publishes it by advancing the head,
+// the consumer reads the block at the tail and hands it back by
+// advancing the tail. head and tail count the blocks passed so far, the
+// slot of a block being its count modulo the number of blocks. each side
+// keeps a copy of the other side's counter and reads the shared counter,
+// which lies on a cache line of its own, only when the copy shows the
+// ring full or empty; all operations are wait-free
+template <typename T>
+class spsc_block_ring
+{
+public:
+  spsc_block_ring(const std::size_t num_blocks, const std::size_t block_size)
+  : m_num_blocks(num_blocks),
+    m_block_size(block_size),
+    m_data(num_blocks * block_size)
+  {
+    if (num_blocks == 0 or block_size == 0) {
+      throw std::invalid_argument("use a non-zero number and size of blocks");
+    }
+  }
+
+  spsc_block_ring(const spsc_block_ring&) = delete;
+  spsc_block_ring& operator=(const spsc_block_ring&) = delete;
+
+  std::size_t
+  num_blocks() const
+  { return m_num_blocks; }
+
+  std::size_t
+  block_size() const
+  { return m_block_size; }
+
+  // producer: block to be written next, or nullptr if the ring is full
+  T*
+  try_claim()
+  {
+    const std::size_t head = m_head.load(std::memory_order_relaxed);
+    if (head - m_tail_copy == m_num_blocks) {
+      m_tail_copy = m_tail.load(std::memory_order_acquire);
+      if (head - m_tail_copy == m_num_blocks) {
+        return nullptr;
+      }
+    }
+    return &m_data[(head % m_num_blocks) * m_block_size];
+  }
+
+  // producer: publish the block returned by try_claim
+  void
+  publish()
+  {
+    m_head.store(m_head.load(std::memory_order_relaxed) + 1, std::memory_order_release);
+    return;
+  }
+
+  // consumer: block to be read next, or nullptr if the ring is empty
+  const T*
+  try_front()
+  {
+    const std::size_t tail = m_tail.load(std::memory_order_relaxed);
+    if (m_head_copy == tail) {
+      m_head_copy = m_head.load(std::memory_order_acquire);
+      if (m_head_copy == tail) {
+        return nullptr;
+      }
+    }
+    return &m_data[(tail % m_num_blocks) * m_block_size];
+  }
+
+  // consumer: hand back the block returned by try_front
+  void
+  pop()
+  {
+    m_tail.store(m_tail.load(std::memory_order_relaxed) + 1, std::memory_order_release);
+    return;
+  }
+
+  // number of blocks published so far, for monitoring by any thread
+  std::uint64_t
+  published() const
+  { return m_head.load(std::memory_order_relaxed); }
+
+private:
+  const std::size_t                       m_num_blocks;
+  const std::size_t                       m_block_size;
+  std::vector<T, aligned_allocator<T>>    m_data;
+
+  // counters and copies of the producer and of the consumer, each
+  // padded to cache lines of their own
+  char                     m_pad0[64];
+  std::atomic<std::size_t> m_head{0};
+  std::size_t              m_tail_copy = 0;
+  char                     m_pad1[64];
+  std::atomic<std::size_t> m_tail{0};
+  std::size_t              m_head_copy = 0;
+  char                     m_pad2[64];
+};
+
+// backpressure policies
+// ---------------------
+// what a side of an async generator does while it cannot proceed, the
+// consumer finding the ring of a distribution empty, or the producer
+// finding all rings full
+// spin  : check again at once, for the lowest latency at the cost of
+//         a busy core
+// yield : yield the processor between checks
+// sleep : sleep for backpressure_sleep between checks, which frees the
+//         core but adds up to that delay
+enum class backpressure {spin, yield, sleep};
+
+constexpr std::chrono::microseconds backpressure_sleep{20};
+
+inline void
+backpressure_wait(const backpressure policy)
+{
+  switch(policy)
+  {
+    case backpressure::yield : std::this_thread::yield(); break;
+    case backpressure::sleep : std::this_thread::sleep_for(backpressure_sleep); break;
+    default                  : break;
+  }
+  return;
+}
+
+// asynchronous generator
+// ----------------------
+// a producer thread owns one generator per distribution and fills a
+// ring of blocks of uniform, normal and exponential variates each, so
+// that the collisions and sweeps of position updates never run on the
+// consumer thread. the variates of each distribution are those of the
+// bulk calls of the generator of that distribution, seeded with
+// derive_seed(seed, k) for k = 0, 1, 2 respectively, whatever the
+// timing of the two threads; one generator per distribution keeps
+// them so, as a shared one would interleave the distributions in the
+// order in which the consumer drains the rings. the generator and the
+// ring of a distribution are created by the producer on the first call
+// drawing from it, which waits for them, so that a consumer of a single
+// distribution holds a single generator and the producer fills a single
+// ring. the calls drawing variates are meant for a single consumer
+// thread, and read the rings wait-free while they hold variates
+template <typename Rng>
+class basic_async_rng
+{
+public:
+  typedef typename Rng::real_type real_type;
+
+  // constructor; the generators are constructed later by the producer
+  // thread, so that their state is first written by the thread which
+  // uses it, and errors of their construction are thrown by the first
+  // call drawing from the distribution
+  // arguments::
+  // seed       : base seed from which the seed of each generator is derived
+  // num        : number of particles in the state of each generator
+  // dt         : time gap between successive collisions
+  // blocks     : number of blocks of each ring
+  // block_size : number of variates per block
+  // consumer   : backpressure policy of the consumer
+  // producer   : backpressure policy of the producer
+  basic_async_rng(unsigned long      seed       = 1234,
+                  const std::size_t  num        = 131072,
+                  const double       dt         = 0.1,
+                  const std::size_t  blocks     = 16,
+                  const std::size_t  block_size = 4096,
+                  const backpressure consumer   = backpressure::yield,
+                  const backpressure producer   = backpressure::sleep)
+  : m_seed(seed),
+    m_num(num),
+    m_dt(dt),
+    m_blocks(blocks),
+    m_block_size(block_size),
+    m_consumer(consumer),
+    m_producer(producer)
+  {
+    if (blocks == 0 or block_size == 0) {
+      throw std::invalid_argument("use a non-zero number and size of blocks");
+    }
+    for (std::size_t k = 0; k < num_streams; k++) {
+      m_streams[k].pos = block_size;
+    }
+    m_thread = std::thread([this]() { produce(); });
+  }
+
+  basic_async_rng(const basic_async_rng&) = delete;
+  basic_async_rng& operator=(const basic_async_rng&) = delete;
+
+  ~basic_async_rng()
+  {
+    m_stop.store(true, std::memory_order_relaxed);
+    m_thread.join();
+  }
+
+  // random number generation calls
+  // ------------------------------
+
+  real_type
+  uniform()
+  { return next(m_streams[0]); }
+
+  real_type
+  normal()
+  { return next(m_streams[1]); }
+
+  real_type
+  exp()
+  { return next(m_streams[2]); }
+
+  void
+  fill_uniform(real_type* out, const std::size_t n)
+  {
+    fill(m_streams[0], out, n);
+    return;
+  }
+
+  void
+  fill_normal(real_type* out, const std::size_t n)
+  {
+    fill(m_streams[1], out, n);
+    return;
+  }
+
+  void
+  fill_exp(real_type* out, const std::size_t n)
+  {
+    fill(m_streams[2], out, n);
+    return;
+  }
+
+  // monitoring
+  // ----------
+
+  // number of times the consumer found a ring empty and had to wait,
+  // to be called by the consumer thread
+  std::uint64_t
+  consumer_stalls() const
+  { return m_consumer_stalls; }
+
+  // number of times the producer found all rings full and waited
+  std::uint64_t
+  producer_stalls() const
+  { return m_producer_stalls.load(std::memory_order_relaxed); }
+
+  // number of blocks produced for all distributions
+  std::uint64_t
+  blocks_produced() const
+  {
+    std::uint64_t blocks = 0;
+    for (std::size_t k = 0; k < num_streams; k++) {
+      if (m_streams[k].state.load(std::memory_order_acquire) == stream_ready) {
+        blocks += m_streams[k].ring->published();
+      }
+    }
+    return blocks;
+  }
+
+private:
+  static constexpr std::size_t num_streams = 3;
+
+  // states of a stream: unused, requested by the consumer, and created
+  // by the producer, or failed to be
+  static constexpr int stream_unused    = 0;
+  static constexpr int stream_requested = 1;
+  static constexpr int stream_ready     = 2;
+  static constexpr int stream_failed    = 3;
+
+  // ring of a distribution, with the generator of the producer and the
+  // block being read by the consumer, pos being the block size while
+  // the consumer holds no block; ring, gen and error are written by the
+  // producer before it publishes the state
+  struct stream
+  {
+    std::atomic<int>                            state{stream_unused};
+    std::unique_ptr<spsc_block_ring<real_type>> ring;
+    std::unique_ptr<Rng>                        gen;
+    std::exception_ptr                          error;
+    const real_type*                            block = nullptr;
+    std::size_t                                 pos   = 0;
+  };
+
+  real_type
+  next(stream& s)
+  {
+    if (s.pos == m_block_size) {
+      next_block(s);
+    }
+    return s.block[s.pos++];
+  }
+
+  void
+  fill(stream& s, real_type* out, std::size_t n)
+  {
+    while (n > 0) {
+      if (s.pos == m_block_size) {
+        next_block(s);
+      }
+      const std::size_t m = std::min(n, m_block_size - s.pos);
+      std::copy(s.block + s.pos, s.block + s.pos + m, out);
+      s.pos += m;
+      out   += m;
+      n     -= m;
+    }
+    return;
+  }
+
+  // hand back the block read up, or have the stream created on the
+  // first call, and wait for the next block
+  void
+  next_block(stream& s)
+  {
+    if (s.block != nullptr) {
+      s.ring->pop();
+    } else {
+      request(s);
+    }
+    const real_type* block = s.ring->try_front();
+    if (block == nullptr) {
+      m_consumer_stalls++;
+      do {
+        backpressure_wait(m_consumer);
+        block = s.ring->try_front();
+      } while (block == nullptr);
+    }
+    s.block = block;
+    s.pos   = 0;
+    return;
+  }
+
+  // have the producer create the stream, and wait until it has; throws
+  // the error of the construction of its generator if that failed
+  void
+  request(stream& s)
+  {
+    int state = s.state.load(std::memory_order_acquire);
+    if (state == stream_unused) {
+      s.state.store(stream_requested, std::memory_order_release);
+    }
+    while (state != stream_ready and state != stream_failed) {
+      backpressure_wait(m_consumer);
+      state = s.state.load(std::memory_order_acquire);
+    }
+    if (state == stream_failed) {
+      std::rethrow_exception(s.error);
+    }
+    return;
+  }
+
+  // create the generator and the ring of a requested stream
+  void
+  create(stream& s, const std::size_t k)
+  {
+    try {
+      s.gen.reset(new Rng(derive_seed(m_seed, k), m_num, m_dt));
+      s.ring.reset(new spsc_block_ring<real_type>(m_blocks, m_block_size));
+    } catch (...) {
+      s.error = std::current_exception();
+      s.state.store(stream_failed, std::memory_order_release);
+      return;
+    }
+    s.state.store(stream_ready, std::memory_order_release);
+    return;
+  }
+
+  // loop of the producer thread, creating the requested streams and
+  // filling every ring with room for a block in turn, until the
+  // generator is destroyed
+  void
+  produce()
+  {
+    while (not m_stop.load(std::memory_order_relaxed)) {
+      bool produced = false;
+      for (std::size_t k = 0; k < num_streams; k++) {
+        stream& s = m_streams[k];
+        const int state = s.state.load(std::memory_order_acquire);
+        if (state == stream_requested) {
+          create(s, k);
+          produced = true;
+        }
+        if (state != stream_ready) {
+          continue;
+        }
+        real_type* block = s.ring->try_claim();
+        if (block == nullptr) {
+          continue;
+        }
+        const std::size_t n = s.ring->block_size();
+        switch(k)
+        {
+          case 0  : s.gen->fill_uniform(block, n); break;
+          case 1  : s.gen->fill_normal(block, n); break;
+          default : s.gen->fill_exp(block, n); break;
+        }
+        s.ring->publish();
+        produced = true;
+      }
+      if (not produced) {
+        m_producer_stalls.fetch_add(1, std::memory_order_relaxed);
+        backpressure_wait(m_producer);
+      }
+    }
+    return;
+  }
+
+  stream              m_streams[num_streams];
+  const unsigned long m_seed;
+  const std::size_t   m_num;
+  const double        m_dt;
+  const std::size_t   m_blocks;
+  const std::size_t   m_block_size;
+  const backpressure  m_consumer;
+  const backpressure  m_producer;
+
+  std::uint64_t              m_consumer_stalls = 0;
+  std::atomic<std::uint64_t> m_producer_stalls{0};
+  std::atomic<bool>          m_stop{false};
+  std::thread                m_thread;
+};
+
+typedef basic_async_rng<rng> async_rng;
+
+} // namespace md
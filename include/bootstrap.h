@@ -0,0 +1,142 @@
+// Copyright (c) 2018 Santosh Ansumali @ JNCASR
+// See LICENSE
+
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <cmath>
+#include "seed.h"
+
+namespace md {
+
+// cheap external RNGs for bootstrapping the particle system
+// ---------------------------------------------------------
+
+// xoshiro256+ generator of 64-bit integers (Blackman and Vigna),
+// a model of UniformRandomBitGenerator, seeded through splitmix64
+class xoshiro256plus
+{
+public:
+  typedef std::uint64_t result_type;
+
+  explicit xoshiro256plus(const unsigned long seed = 1234)
+  {
+    for (std::size_t i = 0; i < 4; i++) {
+      m_s[i] = derive_seed(seed, i);
+    }
+  }
+
+  static constexpr result_type
+  min()
+  { return 0; }
+
+  static constexpr result_type
+  max()
+  { return UINT64_MAX; }
+
+  result_type
+  operator()()
+  {
+    const std::uint64_t result = m_s[0] + m_s[3];
+    const std::uint64_t t      = m_s[1] << 17;
+    m_s[2] ^= m_s[0];
+    m_s[3] ^= m_s[1];
+    m_s[1] ^= m_s[2];
+    m_s[0] ^= m_s[3];
+    m_s[2] ^= t;
+    m_s[3]  = (m_s[3] << 45) | (m_s[3] >> 19);
+    return result;
+  }
+
+  // random real uniformly distributed in [0,1), from the 53 upper bits
+  double
+  uniform()
+  { return ((*this)() >> 11) * (1. / 9007199254740992.); }
+
+private:
+  std::uint64_t m_s[4];
+};
+
+// normal variates with mean 0 and variance 1 by the ziggurat method of
+// Marsaglia and Tsang with 128 layers; the layer index and the value
+// within the layer are taken from disjoint bits of each 64-bit integer,
+// the index from the 7 upper bits and the value from the 32 below them,
+// as the lowest bits of xoshiro256+ are of low linear complexity
+class ziggurat_normal
+{
+public:
+  template <typename XR>
+  double
+  operator()(XR& xr) const
+  {
+    const table& t = tables();
+    for (;;) {
+      const std::uint64_t bits = xr();
+      const std::size_t   iz   = bits >> 57;
+      const std::int32_t  hz   = static_cast<std::int32_t>(bits >> 25);
+      const double        x    = hz * t.wn[iz];
+      if (static_cast<std::uint32_t>(std::abs(static_cast<std::int64_t>(hz))) < t.kn[iz]) {
+        return x;
+      }
+      if (iz == 0) {
+        // sample from the tail beyond r
+        double tx, ty;
+        do {
+          tx = -std::log(1. - xr.uniform()) / r;
+          ty = -std::log(1. - xr.uniform());
+        } while (ty + ty < tx * tx);
+        return (hz > 0) ? r + tx : -r - tx;
+      }
+      // sample from the wedge between layers
+      if (t.fn[iz] + xr.uniform() * (t.fn[iz - 1] - t.fn[iz]) < std::exp(-0.5 * x * x)) {
+        return x;
+      }
+    }
+  }
+
+private:
+  // start of the tail and area of each layer
+  static constexpr double r = 3.442619855899;
+  static constexpr double v = 9.91256303526217e-3;
+
+  struct table
+  {
+    std::uint32_t kn[128];
+    double        wn[128];
+    double        fn[128];
+  };
+
+  static const table&
+  tables()
+  {
+    static const table t = make_tables();
+    return t;
+  }
+
+  static table
+  make_tables()
+  {
+    table t;
+    const double m = 2147483648.;
+    double dn = r;
+    double tn = dn;
+    const double q = v / std::exp(-0.5 * dn * dn);
+    t.kn[0]   = static_cast<std::uint32_t>((dn / q) * m);
+    t.kn[1]   = 0;
+    t.wn[0]   = q / m;
+    t.wn[127] = dn / m;
+    t.fn[0]   = 1.;
+    t.fn[127] = std::exp(-0.5 * dn * dn);
+    for (std::size_t i = 126; i >= 1; i--) {
+      dn          = std::sqrt(-2. * std::log(v / dn + std::exp(-0.5 * dn * dn)));
+      t.kn[i + 1] = static_cast<std::uint32_t>((dn / tn) * m);
+      tn          = dn;
+      t.fn[i]     = std::exp(-0.5 * dn * dn);
+      t.wn[i]     = dn / m;
+    }
+    return t;
+  }
+};
+
+} // namespace md
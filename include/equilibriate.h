@@ -4,16 +4,46 @@
 #pragma once
 
 #include <cstddef>
+#include <cmath>
 #include <random>
+#include "position.h"
 #include "velocity.h"
+#include "bootstrap.h"
 #include "rng_state.h"
 
 namespace md {
 
+// equilibrium values are computed in double precision and then
+// stored with the real type of the particle system
+
+// velocity of a particle in double precision
+template <typename State>
+velocity
+get_velocity(const State& s, const std::size_t idx)
+{
+  velocity v;
+  v.vx = s.vel(idx).vx;
+  v.vy = s.vel(idx).vy;
+  v.vz = s.vel(idx).vz;
+  return v;
+}
+
+// store a double precision velocity of a particle
+template <typename State>
+void
+set_velocity(State& s, const std::size_t idx, const velocity& v)
+{
+  typedef typename State::real_type real;
+  s.vel(idx).vx = static_cast<real>(v.vx);
+  s.vel(idx).vy = static_cast<real>(v.vy);
+  s.vel(idx).vz = static_cast<real>(v.vz);
+  return;
+}
+
 // initialize positions
-template <typename XR>
+template <typename State, typename XR>
 void
-equilibriate_positions(rng_state& s, XR& xr)
+equilibriate_positions(State& s, XR& xr)
 {
   // generate uniform distribution of positions
   std::uniform_real_distribution<double> uniform(0., 1.);
@@ -26,9 +56,9 @@ equilibriate_positions(rng_state& s, XR& xr)
 }
 
 // initialize velocities
-template <typename XR>
+template <typename State, typename XR>
 void
-equilibriate_velocities(rng_state& s, XR& xr)
+equilibriate_velocities(State& s, XR& xr)
 {
   const double temperature = 2.;
   const double stddev = std::sqrt(temperature);
@@ -46,21 +76,76 @@ equilibriate_velocities(rng_state& s, XR& xr)
   avg_vel_cm.vy = 0;
   avg_vel_cm.vz = 0;
   for (std::size_t i = 0; i < s.num_particles(); i++) {
-    avg_vel_cm += s.vel(i);
+    avg_vel_cm += get_velocity(s, i);
   }
   avg_vel_cm /= (1.0 * s.num_particles());
   for (std::size_t i = 0; i < s.num_particles(); i++) {
-    s.vel(i) -= avg_vel_cm;
+    set_velocity(s, i, get_velocity(s, i) - avg_vel_cm);
   }
 
   // enforce chosen temperature value
   double avg_energy = 0;
   for (std::size_t i = 0; i < s.num_particles(); i++) {
-    avg_energy += s.vel(i) * s.vel(i);
+    const velocity v = get_velocity(s, i);
+    avg_energy += v * v;
   }
-  avg_energy /= (1. * rng_state::dim * s.num_particles());
+  avg_energy /= (1. * State::dim * s.num_particles());
   for (std::size_t i = 0; i < s.num_particles(); i++) {
-    s.vel(i) = (stddev * s.vel(i)) / std::sqrt(avg_energy);
+    const velocity v = get_velocity(s, i);
+    set_velocity(s, i, (stddev * v) / std::sqrt(avg_energy));
+  }
+  return;
+}
+
+// initialize positions and velocities using the cheap bootstrap RNGs
+// of bootstrap.h, fusing the sampling, the removal of center of mass
+// velocity, the enforcing of temperature and the first update of
+// positions by a time step dt into two passes over the particles
+template <typename State>
+void
+equilibriate_fast(State& s, const unsigned long seed, const double dt)
+{
+  typedef typename State::real_type real;
+  const double temperature = 2.;
+  const double stddev = std::sqrt(temperature);
+  const std::size_t num = s.num_particles();
+  xoshiro256plus  xr(seed);
+  ziggurat_normal normal;
+
+  // generate uniform distribution of positions and normal distribution
+  // of velocities, accumulating the velocity moments on the way
+  velocity sum_vel;
+  sum_vel.vx = 0;
+  sum_vel.vy = 0;
+  sum_vel.vz = 0;
+  double sum_energy = 0;
+  for (std::size_t i = 0; i < num; i++) {
+    velocity v;
+    v.vx = stddev * normal(xr);
+    v.vy = stddev * normal(xr);
+    v.vz = stddev * normal(xr);
+    sum_vel    += v;
+    sum_energy += v * v;
+    set_velocity(s, i, v);
+    s.pos(i).x = static_cast<real>(xr.uniform());
+    s.pos(i).y = static_cast<real>(xr.uniform());
+    s.pos(i).z = static_cast<real>(xr.uniform());
+  }
+
+  // force center of mass velocity to zero and enforce chosen
+  // temperature value, then advance the positions
+  const velocity avg_vel_cm = sum_vel / (1.0 * num);
+  const double   avg_energy = (sum_energy / num - avg_vel_cm * avg_vel_cm)
+                            / (1. * State::dim);
+  const double   scale      = stddev / std::sqrt(avg_energy);
+  for (std::size_t i = 0; i < num; i++) {
+    const velocity v = (get_velocity(s, i) - avg_vel_cm) * scale;
+    set_velocity(s, i, v);
+    const typename State::velocity_type w = s.vel(i);
+    const real step = static_cast<real>(dt);
+    s.pos(i).x = periodic_wrap(s.pos(i).x + w.vx * step);
+    s.pos(i).y = periodic_wrap(s.pos(i).y + w.vy * step);
+    s.pos(i).z = periodic_wrap(s.pos(i).z + w.vz * step);
   }
   return;
 }
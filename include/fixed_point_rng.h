@@ -0,0 +1,92 @@
+// Copyright (c) 2018 Santosh Ansumali @ JNCASR
+// See LICENSE
+
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include "position.h"
+#include "particle_layout.h"
+#include "rng_state.h"
+#include "rng.h"
+
+namespace md {
+
+// particle system whose coordinates are fixed-point fractions of type
+// Coord, see position.h; a position is advanced by adding the integer
+// displacement v dt, which wraps periodically through the overflow of
+// the addition rather than by compares, and a position
+// takes 3 sizeof(Coord) bytes. the coordinates are read as numbers of
+// type Real on a grid of 2^-S, S being 32 for 32-bit coordinates and
+// the precision of Real for 64-bit ones, so that uniform variates have
+// S random bits, and the leading bits of the integer calls are the
+// coordinate bits exactly. the collisions truncate the displacements
+// to that grid, and thus generate other random sequences than the
+// particle systems with real coordinates
+template <typename Coord = std::uint32_t, typename Real = double>
+class fixed_point_rng_state : public basic_rng_state<fixed_point_layout<Coord>, Real>
+{
+  typedef basic_rng_state<fixed_point_layout<Coord>, Real> base_type;
+
+public:
+  typedef typename base_type::rotation_matrix_type rotation_matrix_type;
+
+  static constexpr unsigned fixed_point_bits = fixed_point<Coord, Real>::fraction_bits;
+
+  // constructor
+  fixed_point_rng_state()
+  {}
+
+  fixed_point_rng_state(const std::size_t num)
+  : base_type(num)
+  {}
+
+  // update position of a particle
+  void
+  update_pos(const std::size_t idx, const Real dt)
+  {
+    base_type::storage().update_pos(idx, dt);
+    return;
+  }
+
+  // update state by colliding two particles
+  void
+  update(const rotation_matrix_type& R,
+         const std::size_t           idx_a,
+         const std::size_t           idx_b,
+         const bool                  update_positions,
+         const Real                  dt)
+  {
+    base_type::update_vel(R, idx_a, idx_b);
+    if (update_positions) {
+      update_pos(idx_a, dt);
+      update_pos(idx_b, dt);
+    }
+    return;
+  }
+
+  // update state by colliding a batch of W pairwise disjoint pairs
+  template <std::size_t W>
+  void
+  update_batch(const rotation_matrix_type& R,
+               const std::size_t*          idx_a,
+               const std::size_t*          idx_b,
+               const bool                  update_positions,
+               const Real                  dt)
+  {
+    base_type::template update_vel_batch<W>(R, idx_a, idx_b);
+    if (update_positions) {
+      for (std::size_t l = 0; l < W; l++) {
+        update_pos(idx_a[l], dt);
+        update_pos(idx_b[l], dt);
+      }
+    }
+    return;
+  }
+};
+
+// molecular dice RNGs with 32-bit and 64-bit fixed-point coordinates
+typedef basic_rng<fixed_point_rng_state<std::uint32_t>> rng_fixed32;
+typedef basic_rng<fixed_point_rng_state<std::uint64_t>> rng_fixed64;
+
+} // namespace md
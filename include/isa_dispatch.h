@@ -0,0 +1,197 @@
+// Copyright (c) 2018 Santosh Ansumali @ JNCASR
+// See LICENSE
+
+#pragma once
+
+#include <cstdlib>
+#include <string>
+
+// dispatch is compiled in for GCC and Clang on x86, unless it is turned
+// off by MD_RNG_NO_DISPATCH or the code is compiled for AVX-512 anyway
+#if !defined(MD_RNG_NO_DISPATCH) && defined(__GNUC__) && \
+    (defined(__x86_64__) || defined(__i386__)) && !defined(__AVX512F__)
+#define MD_RNG_HAS_DISPATCH 1
+#else
+#define MD_RNG_HAS_DISPATCH 0
+#endif
+
+namespace md {
+
+// runtime instruction set dispatch
+// --------------------------------
+// the hot kernels of a generator, i.e. the runs of collisions behind the
+// bulk calls and the buffer refills of the scalar calls, with the sweeps
+// of positions they trigger, and the equilibration of a new generator,
+// are compiled for several instruction sets; the one run is chosen from
+// the features of the processor at first use, so that a build for the
+// baseline x86-64 still runs vectorized code on AVX2 and AVX-512
+// machines. a kernel is a callable run by isa_dispatch, whose variants
+// are compiled with the target attribute and flattened, i.e. the kernel
+// and all of its callees are inlined into each variant; calls that
+// cannot be inlined, such as those into libm, run the baseline code.
+// the AVX-512 variant prefers 256-bit vectors, which run the short
+// loops of the kernels faster than 512-bit ones.
+// with GCC, every kernel, the baseline one included and also in builds
+// without dispatch, is compiled without fusing multiplies and adds, so
+// that the collisions produce the same variates bit for bit whatever the
+// instruction set or -march of the build; the generators run all of
+// their collisions and position updates as kernels, and compute their
+// rotation matrices as MD_RNG_UNFUSED functions. with Clang, which
+// fuses within an expression and has no per-function option for it,
+// this requires compiling with -ffp-contract=off. the environment
+// variable MD_RNG_ISA, one of sse2, avx2 or avx512, caps the instruction
+// set chosen, e.g. to compare them in benchmarks; other values are
+// ignored
+enum class isa {sse2, avx2, avx512};
+
+inline const char*
+isa_name(const isa i)
+{
+  switch(i)
+  {
+    case isa::avx2   : return "avx2";
+    case isa::avx512 : return "avx512";
+    default          : return "sse2";
+  }
+}
+
+// widest instruction set supported by the processor and the operating
+// system, or the one the code is compiled for if dispatch is off
+inline isa
+detect_isa()
+{
+#if MD_RNG_HAS_DISPATCH
+  __builtin_cpu_init();
+  if (__builtin_cpu_supports("avx512f") and __builtin_cpu_supports("avx512dq") and
+      __builtin_cpu_supports("avx512vl")) {
+    return isa::avx512;
+  }
+  if (__builtin_cpu_supports("avx2")) {
+    return isa::avx2;
+  }
+  return isa::sse2;
+#elif defined(__AVX512F__)
+  return isa::avx512;
+#elif defined(__AVX2__)
+  return isa::avx2;
+#else
+  return isa::sse2;
+#endif
+}
+
+// instruction set the kernels run with: the detected one, capped by
+// MD_RNG_ISA if set to a known name; determined once, at first use
+inline isa
+select_isa()
+{
+  const isa detected = detect_isa();
+  const char* cap = std::getenv("MD_RNG_ISA");
+  if (cap == nullptr) {
+    return detected;
+  }
+  const std::string name(cap);
+  isa requested = detected;
+  if (name == "sse2") {
+    requested = isa::sse2;
+  } else if (name == "avx2") {
+    requested = isa::avx2;
+  } else if (name == "avx512") {
+    requested = isa::avx512;
+  }
+  return requested < detected ? requested : detected;
+}
+
+inline isa
+active_isa()
+{
+  static const isa selected = select_isa();
+  return selected;
+}
+
+// attributes of the kernel variants: flattened and, with GCC, without
+// fused multiplies and adds
+#if defined(__clang__)
+#define MD_RNG_KERNEL_ATTRIBUTES flatten
+#elif defined(__GNUC__)
+#define MD_RNG_KERNEL_ATTRIBUTES optimize("fp-contract=off"), flatten
+#endif
+
+// attribute of the functions computing rotation matrices, which are run
+// once per epoch: they are not inlined into the kernels and are compiled
+// without SLP vectorization, as GCC forms fused multiply-add-subtracts
+// from the alternating sums and differences of products of rotation
+// matrices where FMA instructions are available, even with
+// fp-contract=off
+#if defined(__clang__)
+#define MD_RNG_UNFUSED __attribute__((noinline))
+#elif defined(__GNUC__)
+#define MD_RNG_UNFUSED \
+  __attribute__((noinline, optimize("fp-contract=off", "no-tree-slp-vectorize")))
+#else
+#define MD_RNG_UNFUSED
+#endif
+
+#ifdef MD_RNG_KERNEL_ATTRIBUTES
+
+template <typename Kernel>
+__attribute__((MD_RNG_KERNEL_ATTRIBUTES)) void
+run_baseline(Kernel& kernel)
+{
+  kernel();
+  return;
+}
+
+#if MD_RNG_HAS_DISPATCH
+
+template <typename Kernel>
+__attribute__((target("avx2"), MD_RNG_KERNEL_ATTRIBUTES)) void
+run_avx2(Kernel& kernel)
+{
+  kernel();
+  return;
+}
+
+template <typename Kernel>
+__attribute__((target("avx2,avx512f,avx512dq,avx512vl,prefer-vector-width=256"),
+               MD_RNG_KERNEL_ATTRIBUTES)) void
+run_avx512(Kernel& kernel)
+{
+  kernel();
+  return;
+}
+
+#endif
+
+#else
+
+template <typename Kernel>
+void
+run_baseline(Kernel& kernel)
+{
+  kernel();
+  return;
+}
+
+#endif
+
+#undef MD_RNG_KERNEL_ATTRIBUTES
+
+// run a kernel compiled for the active instruction set
+template <typename Kernel>
+void
+isa_dispatch(Kernel kernel)
+{
+#if MD_RNG_HAS_DISPATCH
+  switch(active_isa())
+  {
+    case isa::avx512 : run_avx512(kernel); break;
+    case isa::avx2   : run_avx2(kernel); break;
+    default          : run_baseline(kernel); break;
+  }
+#else
+  run_baseline(kernel);
+#endif
+  return;
+}
+
+} // namespace md
@@ -6,7 +6,23 @@
 #include "position.h"
 #include "velocity.h"
 #include "rotation_matrix.h"
+#include "aligned_allocator.h"
+#include "allocation.h"
+#include "isa_dispatch.h"
+#include "particle_layout.h"
 #include "rng_state.h"
+#include "rng_stats.h"
+#include "bootstrap.h"
 #include "equilibriate.h"
+#include "snapshot.h"
+#include "pair_selection.h"
+#include "rotation_source.h"
 #include "rng.h"
 #include "rng.hh"
+#include "static_rng.h"
+#include "fixed_point_rng.h"
+#include "seed.h"
+#include "rng_pool.h"
+#include "parallel_fill.h"
+#include "async_rng.h"
+#include "sampling.h"
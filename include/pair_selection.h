@@ -0,0 +1,294 @@
+// Copyright (c) 2018 Santosh Ansumali @ JNCASR
+// See LICENSE
+
+#pragma once
+
+#include <algorithm>
+#include <cstddef>
+#include <cstdint>
+#include <stdexcept>
+#include "snapshot.h"
+
+namespace md {
+
+// collision pair selection schemes
+// --------------------------------
+// within each epoch, the run of collisions sharing a rotation matrix,
+// the k-th pair consists of the particles a_k = start + k * shift and
+// b_k = a_k + jump, wrapped periodically, where start, shift and jump
+// are drawn at the start of the epoch; shift is bounded so that the
+// first particles of an epoch are distinct. a scheme provides
+// calc_epoch_pairs(num)       : number of pairs per epoch of num particles
+// refresh(state, uniform, w)  : draw the parameters of the next epoch by
+//                               the callable uniform, w being the number
+//                               of pairs collided together in a batch
+// select(state, k, a, b)      : indices of the k-th pair of the epoch
+// batch_disjoint()            : whether any w consecutive pairs of the
+//                               epoch are pairwise disjoint
+// save(h), restore(h, num)    : conversion of the parameters to and
+//                               from a snapshot header
+
+// parameters of the pairs of an epoch among the particles of a range
+// of size modulus, and their wrapping within that range
+class pair_params
+{
+public:
+  // draw the parameters of num_pairs pairs among modulus particles,
+  // the first particles of the pairs being spread over a span of at
+  // most span particles; if guard is nonzero, the partners are kept
+  // off the first particles of the guard pairs around each pair, so
+  // that no two pairs less than guard pairs apart share a particle; the
+  // guard is capped at (modulus - 2) / (2 shift) pairs, which leaves the
+  // partners at least one offset to be drawn from in small ranges
+  template <typename Uniform>
+  void
+  draw(const std::size_t modulus,
+       const std::size_t span,
+       const std::size_t num_pairs,
+       Uniform&          uniform,
+       const std::size_t batch_width,
+       const std::size_t guard = 0)
+  {
+    const double u_start = uniform();
+    const double u_shift = uniform();
+    const double u_jump  = uniform();
+    m_modulus = modulus;
+    m_start   = static_cast<int>(u_start * modulus);
+    m_shift   = static_cast<int>(u_shift * (span / (num_pairs - 1.) - 1.)) + 1;
+    const std::size_t margin = std::min(guard, (modulus - 2) / (2 * m_shift)) * m_shift;
+    m_jump    = static_cast<int>(u_jump * (modulus - 1 - 2 * margin)) + 1 + margin;
+
+    // pairs k and k + d share a particle if and only if d * m_shift is
+    // congruent to 0 or to +/- m_jump modulo the size of the range
+    m_batch_disjoint = true;
+    for (std::size_t d = 1; d < batch_width; d++) {
+      const std::size_t offset = (d * m_shift) % modulus;
+      if (offset == 0 or offset == m_jump or offset == modulus - m_jump) {
+        m_batch_disjoint = false;
+      }
+    }
+    return;
+  }
+
+  // offset of the first particle of the k-th pair, lying within
+  // [0,2 modulus), and the offset of its partner from it
+  std::size_t
+  first(const std::size_t k) const
+  { return m_start + k * m_shift; }
+
+  std::size_t
+  start() const
+  { return m_start; }
+
+  std::size_t
+  jump() const
+  { return m_jump; }
+
+  // wrap an offset lying within [0,2 modulus) to [0,modulus)
+  std::size_t
+  wrap(const std::size_t x) const
+  { return x - m_modulus * (x >= m_modulus); }
+
+  bool
+  batch_disjoint() const
+  { return m_batch_disjoint; }
+
+  void
+  save(snapshot_header& h) const
+  {
+    h.start          = m_start;
+    h.shift          = m_shift;
+    h.jump           = m_jump;
+    h.batch_disjoint = m_batch_disjoint;
+    return;
+  }
+
+  // throws unless the parameters are those of num_pairs pairs among
+  // modulus particles, whose offsets lie within [0,2 modulus)
+  void
+  restore(const snapshot_header& h,
+          const std::size_t      modulus,
+          const std::size_t      num_pairs)
+  {
+    if (h.start >= modulus or h.shift == 0 or h.shift > modulus / (num_pairs - 1) or
+        h.jump == 0 or h.jump >= modulus) {
+      throw std::runtime_error("inconsistent RNG snapshot");
+    }
+    m_modulus        = modulus;
+    m_start          = h.start;
+    m_shift          = h.shift;
+    m_jump           = h.jump;
+    m_batch_disjoint = h.batch_disjoint;
+    return;
+  }
+
+private:
+  std::size_t m_modulus = 1;
+  std::size_t m_start   = 0;
+  std::size_t m_shift   = 0;
+  std::size_t m_jump    = 0;
+  bool        m_batch_disjoint = false;
+};
+
+// original scheme, whose epochs of num / 8 pairs are spread over the
+// whole particle system, so that nearly every collision touches two
+// particles far apart in memory
+class global_pair_selection
+{
+public:
+  static constexpr std::size_t
+  calc_epoch_pairs(const std::size_t num)
+  { return num / 8; }
+
+  template <typename State, typename Uniform>
+  void
+  refresh(const State& s, Uniform uniform, const std::size_t batch_width)
+  {
+    const std::size_t num = s.num_particles();
+    m_params.draw(num, num, calc_epoch_pairs(num), uniform, batch_width);
+    return;
+  }
+
+  // the particle indices are wrapped by the particle system, which may
+  // know the number of particles at compile time
+  template <typename State>
+  void
+  select(const State& s, const std::size_t k, std::size_t& a, std::size_t& b) const
+  {
+    a = s.wrap_index(m_params.first(k));
+    b = s.wrap_index(a + m_params.jump());
+    return;
+  }
+
+  bool
+  batch_disjoint() const
+  { return m_params.batch_disjoint(); }
+
+  void
+  save(snapshot_header& h) const
+  {
+    m_params.save(h);
+    h.tile_size   = 0;
+    h.tile_epoch  = 0;
+    h.tile_origin = 0;
+    return;
+  }
+
+  void
+  restore(const snapshot_header& h, const std::size_t num)
+  {
+    if (h.tile_size != 0) {
+      throw std::runtime_error("RNG snapshot of a generator with another pair selection scheme");
+    }
+    m_params.restore(h, num, calc_epoch_pairs(num));
+    return;
+  }
+
+private:
+  pair_params m_params;
+};
+
+// cache-aware scheme: every MixInterval epochs form a cycle whose
+// first, mixing epoch pairs the particles of two windows of about
+// TileSize consecutive particles at random origins and distance, and
+// whose other, local epochs select their pairs as above among the
+// particles of a tile of TileSize consecutive particles starting with
+// the first window, which stays in cache for the rest of the cycle.
+// all epochs have TileSize / 8 pairs, so that a local epoch is an
+// epoch of a generator of TileSize particles, and the pairs of an
+// epoch run through the particles with small strides which the
+// hardware prefetcher follows. systems of at most TileSize particles
+// form a single tile
+template <std::size_t TileSize = 4096, std::size_t MixInterval = 8>
+class tiled_pair_selection
+{
+  static_assert(TileSize >= 2048, "use tiles of at least 2048 particles");
+  static_assert(MixInterval >= 1, "use a positive mixing interval");
+
+public:
+  static constexpr std::size_t tile_size    = TileSize;
+  static constexpr std::size_t mix_interval = MixInterval;
+
+  // pairs of a local epoch less than guard pairs apart do not share a
+  // particle; in a tile, a particle colliding twice in an epoch would
+  // otherwise often do so a few pairs apart, correlating the variates
+  static constexpr std::size_t guard = 64;
+
+  static constexpr std::size_t
+  calc_epoch_pairs(const std::size_t num)
+  { return calc_tile(num) / 8; }
+
+  template <typename State, typename Uniform>
+  void
+  refresh(const State& s, Uniform uniform, const std::size_t batch_width)
+  {
+    const std::size_t num  = s.num_particles();
+    const std::size_t tile = calc_tile(num);
+    m_epoch = (m_epoch + 1) % MixInterval;
+    if (m_epoch == 0) {
+      m_params.draw(num, tile, calc_epoch_pairs(num), uniform, batch_width);
+      m_origin = std::min(m_params.start(), num - tile);
+    } else {
+      m_params.draw(tile, tile, calc_epoch_pairs(num), uniform, batch_width, guard);
+    }
+    return;
+  }
+
+  // the offsets are wrapped within the particle system in mixing epochs
+  // and within the tile in local epochs, and tiles do not wrap around
+  // the end of the particle system
+  template <typename State>
+  void
+  select(const State&, const std::size_t k, std::size_t& a, std::size_t& b) const
+  {
+    const std::size_t a_off = m_params.wrap(m_params.first(k));
+    const std::size_t b_off = m_params.wrap(a_off + m_params.jump());
+    const std::size_t origin = (m_epoch != 0) * m_origin;
+    a = origin + a_off;
+    b = origin + b_off;
+    return;
+  }
+
+  bool
+  batch_disjoint() const
+  { return m_params.batch_disjoint(); }
+
+  void
+  save(snapshot_header& h) const
+  {
+    m_params.save(h);
+    h.tile_size   = TileSize;
+    h.tile_epoch  = m_epoch;
+    h.tile_origin = m_origin;
+    return;
+  }
+
+  void
+  restore(const snapshot_header& h, const std::size_t num)
+  {
+    if (h.tile_size != TileSize or h.tile_epoch >= MixInterval) {
+      throw std::runtime_error("RNG snapshot of a generator with another pair selection scheme");
+    }
+    if (h.tile_origin > num - calc_tile(num)) {
+      throw std::runtime_error("RNG snapshot with a tile beyond the particles");
+    }
+    m_epoch  = h.tile_epoch;
+    m_origin = h.tile_origin;
+    m_params.restore(h, m_epoch != 0 ? calc_tile(num) : num, calc_epoch_pairs(num));
+    return;
+  }
+
+private:
+  static constexpr std::size_t
+  calc_tile(const std::size_t num)
+  { return num < TileSize ? num : TileSize; }
+
+  pair_params m_params;
+
+  // index of the current epoch within its cycle, the first refresh
+  // starting a cycle, and origin of the tile of the cycle
+  std::size_t m_epoch  = MixInterval - 1;
+  std::size_t m_origin = 0;
+};
+
+} // namespace md
@@ -0,0 +1,146 @@
+// Copyright (c) 2018 Santosh Ansumali @ JNCASR
+// See LICENSE
+
+#pragma once
+
+#include <cstddef>
+#include <algorithm>
+#include <atomic>
+#include <exception>
+#include <stdexcept>
+#include <thread>
+#include <vector>
+#include "seed.h"
+#include "rng.h"
+
+namespace md {
+
+// deterministic multi-threaded bulk generation
+// --------------------------------------------
+// the output array is split into fixed-size chunks, and the c-th chunk
+// is filled by its own generator seeded with derive_seed(seed, c); the
+// values written therefore depend only on the seed and the chunk size,
+// never on the number of threads or on the order in which the threads
+// pick up the chunks
+//
+// arguments::
+// out     : array to be filled with n random variates
+// seed    : base seed from which the seed of each chunk is derived
+// threads : number of threads used, 0 selects the hardware concurrency
+// chunk   : number of variates per chunk
+// num, dt : parameters of the generator of each chunk
+
+template <variate V, typename Rng>
+void
+fill_parallel(typename Rng::real_type* out,
+              const std::size_t       n,
+              unsigned long           seed,
+              unsigned                threads,
+              const std::size_t       chunk,
+              const std::size_t       num,
+              const double            dt)
+{
+  if (chunk == 0) {
+    throw std::invalid_argument("use a non-zero chunk size");
+  }
+  const std::size_t num_chunks = (n + chunk - 1) / chunk;
+  if (threads == 0) {
+    // the hardware concurrency is 0 if it cannot be determined
+    threads = std::max(1u, std::thread::hardware_concurrency());
+  }
+  if (threads > num_chunks) {
+    threads = num_chunks;
+  }
+
+  // threads repeatedly claim the next unfilled chunk
+  std::atomic<std::size_t> next_chunk(0);
+  std::vector<std::exception_ptr> errors(threads);
+  auto work = [&](const unsigned t) {
+    try {
+      for (std::size_t c = next_chunk++; c < num_chunks; c = next_chunk++) {
+        const std::size_t begin = c * chunk;
+        const std::size_t size  = (begin + chunk < n) ? chunk : n - begin;
+        Rng r(derive_seed(seed, c), num, dt);
+        switch(V)
+        {
+          case variate::unif : r.fill_uniform(out + begin, size); break;
+          case variate::norm : r.fill_normal(out + begin, size); break;
+          case variate::expo : r.fill_exp(out + begin, size); break;
+          default            : break;
+        }
+      }
+    } catch (...) {
+      errors[t] = std::current_exception();
+    }
+  };
+
+  // if a thread cannot be started, the threads started so far are
+  // joined before the error is passed on
+  std::vector<std::thread> pool;
+  try {
+    for (unsigned t = 1; t < threads; t++) {
+      pool.emplace_back(work, t);
+    }
+  } catch (...) {
+    for (std::size_t t = 0; t < pool.size(); t++) {
+      pool[t].join();
+    }
+    throw;
+  }
+  if (threads > 0) {
+    work(0);
+  }
+  for (std::size_t t = 0; t < pool.size(); t++) {
+    pool[t].join();
+  }
+  for (std::size_t t = 0; t < errors.size(); t++) {
+    if (errors[t]) {
+      std::rethrow_exception(errors[t]);
+    }
+  }
+  return;
+}
+
+template <typename Rng = rng>
+void
+fill_uniform_parallel(typename Rng::real_type* out,
+                      const std::size_t       n,
+                      unsigned long           seed,
+                      unsigned                threads = 0,
+                      const std::size_t       chunk   = 1 << 24,
+                      const std::size_t       num     = 131072,
+                      const double            dt      = 0.1)
+{
+  fill_parallel<variate::unif, Rng>(out, n, seed, threads, chunk, num, dt);
+  return;
+}
+
+template <typename Rng = rng>
+void
+fill_normal_parallel(typename Rng::real_type* out,
+                     const std::size_t       n,
+                     unsigned long           seed,
+                     unsigned                threads = 0,
+                     const std::size_t       chunk   = 1 << 24,
+                     const std::size_t       num     = 131072,
+                     const double            dt      = 0.1)
+{
+  fill_parallel<variate::norm, Rng>(out, n, seed, threads, chunk, num, dt);
+  return;
+}
+
+template <typename Rng = rng>
+void
+fill_exp_parallel(typename Rng::real_type* out,
+                  const std::size_t       n,
+                  unsigned long           seed,
+                  unsigned                threads = 0,
+                  const std::size_t       chunk   = 1 << 24,
+                  const std::size_t       num     = 131072,
+                  const double            dt      = 0.1)
+{
+  fill_parallel<variate::expo, Rng>(out, n, seed, threads, chunk, num, dt);
+  return;
+}
+
+} // namespace md
@@ -0,0 +1,507 @@
+// Copyright (c) 2018 Santosh Ansumali @ JNCASR
+// See LICENSE
+
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <array>
+#include <stdexcept>
+#include <vector>
+#include "aligned_allocator.h"
+#include "allocation.h"
+#include "position.h"
+#include "velocity.h"
+
+namespace md {
+
+// storage layouts for positions and velocities of the particles
+// ---------------------------------------------------------------
+// every storage offers the same pos(i)/vel(i) accessors, which return
+// either plain references to position/velocity records or reference
+// proxies to the separately stored components, and prefetch(i), which
+// hints the processor to fetch the records of a particle about to be
+// collided; a layout selects the storage for a given real type through
+// its nested storage template. the heap storages take the memory of
+// their arrays through an allocation policy, see allocation.h, which
+// allocated_layout selects
+
+// hint the processor to fetch the cache line holding p for writing
+inline void
+prefetch_line(const void* p)
+{
+#if defined(__GNUC__)
+  __builtin_prefetch(p, 1, 3);
+#else
+  (void) p;
+#endif
+  return;
+}
+
+// hint the processor to fetch the cache lines holding the bytes
+// bytes from p on, bytes being at most a cache line
+inline void
+prefetch_range(const void* p, const std::size_t bytes)
+{
+  prefetch_line(p);
+  prefetch_line(static_cast<const char*>(p) + bytes - 1);
+  return;
+}
+
+// array of structures: positions and velocities are held in two
+// separate arrays of 3-component records
+template <typename Real, typename Allocation = aligned_allocation>
+class aos_storage
+{
+public:
+  typedef basic_position<Real>        position_type;
+  typedef basic_velocity<Real>        velocity_type;
+  typedef position_type&              position_reference;
+  typedef const position_type&        const_position_reference;
+  typedef velocity_type&              velocity_reference;
+  typedef const velocity_type&        const_velocity_reference;
+
+  std::size_t
+  size() const
+  { return m_vel.size(); }
+
+  void
+  resize(const std::size_t num)
+  {
+    m_pos.resize(num);
+    m_vel.resize(num);
+  }
+
+  position_reference
+  pos(const std::size_t idx)
+  { return m_pos[idx]; }
+
+  const_position_reference
+  pos(const std::size_t idx) const
+  { return m_pos[idx]; }
+
+  velocity_reference
+  vel(const std::size_t idx)
+  { return m_vel[idx]; }
+
+  const_velocity_reference
+  vel(const std::size_t idx) const
+  { return m_vel[idx]; }
+
+  void
+  prefetch(const std::size_t idx) const
+  {
+    prefetch_range(&m_pos[idx], sizeof(position_type));
+    prefetch_range(&m_vel[idx], sizeof(velocity_type));
+    return;
+  }
+
+  // update positions of all particles
+  void
+  update_all_pos(const Real dt)
+  {
+    for (std::size_t i = 0; i < size(); i++) {
+      position_type&       p = pos(i);
+      const velocity_type& v = vel(i);
+      p.x = periodic_wrap(p.x + v.vx * dt);
+      p.y = periodic_wrap(p.y + v.vy * dt);
+      p.z = periodic_wrap(p.z + v.vz * dt);
+    }
+    return;
+  }
+
+private:
+  template <typename T>
+  using array = std::vector<T, typename Allocation::template allocator<T>>;
+
+  array<position_type> m_pos;
+  array<velocity_type> m_vel;
+};
+
+// interleaved: position and velocity of each particle are held
+// together in one record, so that a collision touches a single record
+// per particle rather than one in each of two arrays; records are
+// padded to a power of two bytes, 64 for doubles and 32 for floats, so
+// that none straddles two cache lines
+template <typename Real, typename Allocation = aligned_allocation>
+class interleaved_storage
+{
+public:
+  typedef basic_position<Real>        position_type;
+  typedef basic_velocity<Real>        velocity_type;
+  typedef position_type&              position_reference;
+  typedef const position_type&        const_position_reference;
+  typedef velocity_type&              velocity_reference;
+  typedef const velocity_type&        const_velocity_reference;
+
+  std::size_t
+  size() const
+  { return m_particles.size(); }
+
+  void
+  resize(const std::size_t num)
+  { m_particles.resize(num); }
+
+  position_reference
+  pos(const std::size_t idx)
+  { return m_particles[idx].pos; }
+
+  const_position_reference
+  pos(const std::size_t idx) const
+  { return m_particles[idx].pos; }
+
+  velocity_reference
+  vel(const std::size_t idx)
+  { return m_particles[idx].vel; }
+
+  const_velocity_reference
+  vel(const std::size_t idx) const
+  { return m_particles[idx].vel; }
+
+  void
+  prefetch(const std::size_t idx) const
+  {
+    prefetch_range(&m_particles[idx], sizeof(particle));
+    return;
+  }
+
+  // update positions of all particles
+  void
+  update_all_pos(const Real dt)
+  {
+    for (std::size_t i = 0; i < size(); i++) {
+      position_type&       p = pos(i);
+      const velocity_type& v = vel(i);
+      p.x = periodic_wrap(p.x + v.vx * dt);
+      p.y = periodic_wrap(p.y + v.vy * dt);
+      p.z = periodic_wrap(p.z + v.vz * dt);
+    }
+    return;
+  }
+
+private:
+  static constexpr std::size_t record_align =
+    sizeof(position_type) + sizeof(velocity_type) <= 32 ? 32 : 64;
+
+  struct alignas(record_align) particle
+  {
+    position_type pos;
+    velocity_type vel;
+  };
+
+  std::vector<particle, typename Allocation::template allocator<particle>> m_particles;
+};
+
+// structure of arrays: each coordinate and velocity component is held
+// in a separate aligned array, so that sweeps over all particles can
+// be vectorized
+template <typename Real, typename Allocation = aligned_allocation>
+class soa_storage
+{
+public:
+  typedef basic_position<Real>        position_type;
+  typedef basic_velocity<Real>        velocity_type;
+  typedef basic_position_ref<Real>    position_reference;
+  typedef position_type               const_position_reference;
+  typedef basic_velocity_ref<Real>    velocity_reference;
+  typedef velocity_type               const_velocity_reference;
+
+  std::size_t
+  size() const
+  { return m_vx.size(); }
+
+  void
+  resize(const std::size_t num)
+  {
+    m_x.resize(num);
+    m_y.resize(num);
+    m_z.resize(num);
+    m_vx.resize(num);
+    m_vy.resize(num);
+    m_vz.resize(num);
+  }
+
+  position_reference
+  pos(const std::size_t idx)
+  { return position_reference{m_x[idx], m_y[idx], m_z[idx]}; }
+
+  const_position_reference
+  pos(const std::size_t idx) const
+  {
+    position_type p;
+    p.x = m_x[idx];
+    p.y = m_y[idx];
+    p.z = m_z[idx];
+    return p;
+  }
+
+  velocity_reference
+  vel(const std::size_t idx)
+  { return velocity_reference{m_vx[idx], m_vy[idx], m_vz[idx]}; }
+
+  const_velocity_reference
+  vel(const std::size_t idx) const
+  {
+    velocity_type v;
+    v.vx = m_vx[idx];
+    v.vy = m_vy[idx];
+    v.vz = m_vz[idx];
+    return v;
+  }
+
+  void
+  prefetch(const std::size_t idx) const
+  {
+    prefetch_line(&m_x[idx]);
+    prefetch_line(&m_y[idx]);
+    prefetch_line(&m_z[idx]);
+    prefetch_line(&m_vx[idx]);
+    prefetch_line(&m_vy[idx]);
+    prefetch_line(&m_vz[idx]);
+    return;
+  }
+
+  // update positions of all particles, one component array at a time
+  void
+  update_all_pos(const Real dt)
+  {
+    update_coords(m_x, m_vx, dt);
+    update_coords(m_y, m_vy, dt);
+    update_coords(m_z, m_vz, dt);
+    return;
+  }
+
+private:
+  typedef std::vector<Real, typename Allocation::template allocator<Real>> array;
+
+  void
+  update_coords(array& x, const array& vx, const Real dt)
+  {
+    Real* const       px  = x.data();
+    const Real* const pvx = vx.data();
+    for (std::size_t i = 0; i < x.size(); i++) {
+      px[i] = periodic_wrap(px[i] + pvx[i] * dt);
+    }
+    return;
+  }
+
+  array m_x;
+  array m_y;
+  array m_z;
+  array m_vx;
+  array m_vy;
+  array m_vz;
+};
+
+// fixed-point array of structures: as aos_storage, but the coordinates
+// are held as fixed-point fractions of type Coord, see position.h, and
+// are read and written as numbers of type Real through references; a
+// position is advanced by integer additions, which wrap periodically
+// by themselves
+template <typename Real, typename Coord, typename Allocation = aligned_allocation>
+class fixed_point_storage
+{
+public:
+  typedef basic_position<Real>             position_type;
+  typedef basic_velocity<Real>             velocity_type;
+  typedef fixed_position_ref<Coord, Real>  position_reference;
+  typedef position_type                    const_position_reference;
+  typedef velocity_type&                   velocity_reference;
+  typedef const velocity_type&             const_velocity_reference;
+
+  typedef fixed_point<Coord, Real>         coord_traits;
+  typedef fixed_position<Coord>            coords_type;
+
+  std::size_t
+  size() const
+  { return m_vel.size(); }
+
+  void
+  resize(const std::size_t num)
+  {
+    m_pos.resize(num);
+    m_vel.resize(num);
+  }
+
+  position_reference
+  pos(const std::size_t idx)
+  {
+    coords_type& c = m_pos[idx];
+    typedef fixed_coord_ref<Coord, Real> ref;
+    return position_reference{ref(c.x), ref(c.y), ref(c.z)};
+  }
+
+  const_position_reference
+  pos(const std::size_t idx) const
+  {
+    const coords_type& c = m_pos[idx];
+    position_type p;
+    p.x = coord_traits::to_real(c.x);
+    p.y = coord_traits::to_real(c.y);
+    p.z = coord_traits::to_real(c.z);
+    return p;
+  }
+
+  velocity_reference
+  vel(const std::size_t idx)
+  { return m_vel[idx]; }
+
+  const_velocity_reference
+  vel(const std::size_t idx) const
+  { return m_vel[idx]; }
+
+  // fixed-point coordinates of a particle
+  coords_type&
+  coords(const std::size_t idx)
+  { return m_pos[idx]; }
+
+  void
+  prefetch(const std::size_t idx) const
+  {
+    prefetch_range(&m_pos[idx], sizeof(coords_type));
+    prefetch_range(&m_vel[idx], sizeof(velocity_type));
+    return;
+  }
+
+  // advance a position by the displacement v dt
+  void
+  update_pos(const std::size_t idx, const Real dt)
+  {
+    coords_type&         c = m_pos[idx];
+    const velocity_type& v = m_vel[idx];
+    c.x += coord_traits::from_real(v.vx * dt);
+    c.y += coord_traits::from_real(v.vy * dt);
+    c.z += coord_traits::from_real(v.vz * dt);
+    return;
+  }
+
+  // update positions of all particles
+  void
+  update_all_pos(const Real dt)
+  {
+    for (std::size_t i = 0; i < size(); i++) {
+      update_pos(i, dt);
+    }
+    return;
+  }
+
+private:
+  template <typename T>
+  using array = std::vector<T, typename Allocation::template allocator<T>>;
+
+  array<coords_type>   m_pos;
+  array<velocity_type> m_vel;
+};
+
+// fixed-size array of structures: as aos_storage, but the N records are
+// held in arrays within the storage object itself, so that no memory is
+// allocated on the heap and the number of particles is a constant
+template <typename Real, std::size_t N>
+class fixed_aos_storage
+{
+public:
+  typedef basic_position<Real>        position_type;
+  typedef basic_velocity<Real>        velocity_type;
+  typedef position_type&              position_reference;
+  typedef const position_type&        const_position_reference;
+  typedef velocity_type&              velocity_reference;
+  typedef const velocity_type&        const_velocity_reference;
+
+  static constexpr std::size_t
+  size()
+  { return N; }
+
+  void
+  resize(const std::size_t num)
+  {
+    if (num != N) {
+      throw std::invalid_argument("number of particles differs from the fixed size");
+    }
+  }
+
+  position_reference
+  pos(const std::size_t idx)
+  { return m_pos[idx]; }
+
+  const_position_reference
+  pos(const std::size_t idx) const
+  { return m_pos[idx]; }
+
+  velocity_reference
+  vel(const std::size_t idx)
+  { return m_vel[idx]; }
+
+  const_velocity_reference
+  vel(const std::size_t idx) const
+  { return m_vel[idx]; }
+
+  void
+  prefetch(const std::size_t idx) const
+  {
+    prefetch_range(&m_pos[idx], sizeof(position_type));
+    prefetch_range(&m_vel[idx], sizeof(velocity_type));
+    return;
+  }
+
+  // update positions of all particles
+  void
+  update_all_pos(const Real dt)
+  {
+    for (std::size_t i = 0; i < N; i++) {
+      position_type&       p = pos(i);
+      const velocity_type& v = vel(i);
+      p.x = periodic_wrap(p.x + v.vx * dt);
+      p.y = periodic_wrap(p.y + v.vy * dt);
+      p.z = periodic_wrap(p.z + v.vz * dt);
+    }
+    return;
+  }
+
+private:
+  std::array<position_type, N> m_pos;
+  std::array<velocity_type, N> m_vel;
+};
+
+// layouts, each selecting the respective storage
+struct aos_layout
+{
+  template <typename Real, typename Allocation = aligned_allocation>
+  using storage = aos_storage<Real, Allocation>;
+};
+
+struct interleaved_layout
+{
+  template <typename Real, typename Allocation = aligned_allocation>
+  using storage = interleaved_storage<Real, Allocation>;
+};
+
+struct soa_layout
+{
+  template <typename Real, typename Allocation = aligned_allocation>
+  using storage = soa_storage<Real, Allocation>;
+};
+
+template <typename Coord = std::uint32_t>
+struct fixed_point_layout
+{
+  template <typename Real, typename Allocation = aligned_allocation>
+  using storage = fixed_point_storage<Real, Coord, Allocation>;
+};
+
+template <std::size_t N>
+struct fixed_aos_layout
+{
+  template <typename Real>
+  using storage = fixed_aos_storage<Real, N>;
+};
+
+// heap layout whose arrays are allocated by the allocation policy
+// Allocation, e.g. allocated_layout<aos_layout, huge_page_allocation>
+template <typename Layout, typename Allocation>
+struct allocated_layout
+{
+  template <typename Real>
+  using storage = typename Layout::template storage<Real, Allocation>;
+};
+
+} // namespace md
@@ -3,14 +3,176 @@
 
 #pragma once
 
+#include <cstdint>
+#include <limits>
+#include <type_traits>
+
 namespace md {
 
+// wrap coordinate to lie within [0,1]
+template <typename Real>
+inline Real
+periodic_wrap(const Real x)
+{ return x - Real(1.0) * (x > Real(1.0)) + Real(1.0) * (x < Real(0.0)); }
+
 // spatial coordinates of a particle
-struct position
+template <typename Real>
+struct basic_position
+{
+  Real x;
+  Real y;
+  Real z;
+};
+
+typedef basic_position<double> position;
+
+// reference to spatial coordinates of a particle, for storage
+// layouts which do not hold the coordinates in a position record
+template <typename Real>
+struct basic_position_ref
+{
+  basic_position_ref&
+  operator=(const basic_position<Real>& rhs)
+  {
+    this->x = rhs.x;
+    this->y = rhs.y;
+    this->z = rhs.z;
+    return *this;
+  }
+
+  basic_position_ref&
+  operator=(const basic_position_ref& rhs)
+  { return *this = static_cast<basic_position<Real>>(rhs); }
+
+  operator basic_position<Real>() const
+  {
+    basic_position<Real> p;
+    p.x = this->x;
+    p.y = this->y;
+    p.z = this->z;
+    return p;
+  }
+
+  Real& x;
+  Real& y;
+  Real& z;
+};
+
+typedef basic_position_ref<double> position_ref;
+
+// fixed-point coordinates
+// -----------------------
+// a coordinate in [0,1) held as an unsigned integer u of type Coord of B
+// bits, standing for the fraction u / 2^B; only the leading S bits are
+// used, S being the smaller of B and the precision of Real, so that each
+// coordinate is exactly a number of type Real. the sum of coordinates
+// wraps periodically by the modular arithmetic of Coord, at no cost
+template <typename Coord, typename Real>
+struct fixed_point
+{
+  static_assert(std::is_unsigned<Coord>::value and sizeof(Coord) <= 8,
+                "use an unsigned integer type of at most 64 bits");
+
+  static constexpr unsigned coord_bits    = std::numeric_limits<Coord>::digits;
+  static constexpr unsigned fraction_bits =
+    coord_bits < unsigned(std::numeric_limits<Real>::digits) ?
+    coord_bits : unsigned(std::numeric_limits<Real>::digits);
+  static constexpr unsigned unused_bits   = coord_bits - fraction_bits;
+
+  // 2^S, the number of fractions of the unit interval
+  static constexpr Real
+  scale()
+  { return static_cast<Real>(std::uint64_t(1) << fraction_bits); }
+
+  // real number of a coordinate, which is exact
+  static Real
+  to_real(const Coord u)
+  { return static_cast<Real>(u >> unused_bits) * (Real(1) / scale()); }
+
+  // coordinate of a real number, truncated to S bits and wrapped to
+  // [0,1); x is a position or a displacement, and must lie within
+  // (-2^(63-S),2^(63-S)), i.e. within 2^31 for 32-bit coordinates and
+  // within 2^10 for 64-bit coordinates of double precision
+  static Coord
+  from_real(const Real x)
+  {
+    const std::int64_t u = static_cast<std::int64_t>(x * scale());
+    return static_cast<Coord>(static_cast<std::uint64_t>(u) << unused_bits);
+  }
+};
+
+// reference to a fixed-point coordinate, which reads and writes it as a
+// number of type Real
+template <typename Coord, typename Real>
+class fixed_coord_ref
 {
-  double x;
-  double y;
-  double z;
+public:
+  explicit fixed_coord_ref(Coord& u)
+  : m_u(u)
+  {}
+
+  fixed_coord_ref(const fixed_coord_ref&) = default;
+
+  fixed_coord_ref&
+  operator=(const Real x)
+  {
+    m_u = fixed_point<Coord, Real>::from_real(x);
+    return *this;
+  }
+
+  fixed_coord_ref&
+  operator=(const fixed_coord_ref& rhs)
+  {
+    m_u = rhs.m_u;
+    return *this;
+  }
+
+  operator Real() const
+  { return fixed_point<Coord, Real>::to_real(m_u); }
+
+private:
+  Coord& m_u;
+};
+
+// fixed-point coordinates of a particle
+template <typename Coord>
+struct fixed_position
+{
+  Coord x;
+  Coord y;
+  Coord z;
+};
+
+// reference to fixed-point coordinates of a particle, for storage
+// layouts which hold the coordinates as fixed-point fractions
+template <typename Coord, typename Real>
+struct fixed_position_ref
+{
+  fixed_position_ref&
+  operator=(const basic_position<Real>& rhs)
+  {
+    this->x = rhs.x;
+    this->y = rhs.y;
+    this->z = rhs.z;
+    return *this;
+  }
+
+  fixed_position_ref&
+  operator=(const fixed_position_ref& rhs)
+  { return *this = static_cast<basic_position<Real>>(rhs); }
+
+  operator basic_position<Real>() const
+  {
+    basic_position<Real> p;
+    p.x = this->x;
+    p.y = this->y;
+    p.z = this->z;
+    return p;
+  }
+
+  fixed_coord_ref<Coord, Real> x;
+  fixed_coord_ref<Coord, Real> y;
+  fixed_coord_ref<Coord, Real> z;
 };
 
 } // namespace md
@@ -4,18 +4,59 @@
 #pragma once
 
 #include <cstddef>
+#include <cstdint>
 #include <array>
+#include <iosfwd>
+#include <limits>
 #include <string>
+#include <vector>
+#include "bootstrap.h"
+#include "isa_dispatch.h"
 #include "rotation_matrix.h"
+#include "rotation_source.h"
 #include "rng_state.h"
+#include "rng_stats.h"
+#include "pair_selection.h"
+#include "snapshot.h"
 
 namespace md {
 
-class rng
+// kinds of random variates sampled from a collision: the position
+// coordinates, the components of the relative outgoing velocity, the
+// average kinetic energies along each axis, and the coordinates of the
+// first particle together with the relative outgoing velocity
+enum class variate {unif, norm, expo, unif_norm};
+
+// tag selecting the fast construction of a generator
+struct fast_start_t {};
+constexpr fast_start_t fast_start{};
+
+// tag selecting the construction of a generator from a snapshot
+struct restore_t {};
+constexpr restore_t restore{};
+
+// molecular dice RNG whose state is a particle system of type State,
+// see rng_state.h, whose collision pairs are selected by the scheme
+// Pairs, see pair_selection.h, and whose rotation matrices are drawn by
+// the source Rotation, see rotation_source.h; random variates are
+// generated as real numbers of the real type of the particle system
+template <typename State,
+          typename Pairs    = global_pair_selection,
+          typename Rotation = euler_rotation>
+class basic_rng
 {
 public:
   // dimension of particle system
-  static const std::size_t dim = rng_state::dim;
+  static const std::size_t dim = State::dim;
+
+  // collision pair selection scheme
+  typedef Pairs pair_selection_type;
+
+  // source of the rotation matrices
+  typedef Rotation rotation_source_type;
+
+  // type of the generated random variates
+  typedef typename State::real_type real_type;
 
   // constructor
   // arguments::
@@ -23,92 +64,388 @@ public:
   //          particles to an equilibrium state
   // num    : number of particles in the RNG state
   // dt     : time gap between successive collisions
-  rng(unsigned long     seed = 1234,
-      const std::size_t num  = 131072,
-      const double      dt   = 0.1);
+  basic_rng(unsigned long     seed = 1234,
+            const std::size_t num  = State::default_num_particles,
+            const double      dt   = State::default_time_step);
+
+  // constructor with fast start: same arguments as above, but the
+  // particle system is equilibriated by equilibriate_fast using the
+  // cheap bootstrap RNGs, which yields a different random sequence
+  // for a given seed than the above constructor
+  basic_rng(fast_start_t,
+            unsigned long     seed = 1234,
+            const std::size_t num  = State::default_num_particles,
+            const double      dt   = State::default_time_step);
+
+  // constructor from a template generator: the equilibriated particle
+  // system of the template is copied and re-randomized in place by a
+  // random translation of all positions, a random rotation of all
+  // velocities and num / 2 collisions, so that many generators can be
+  // started without equilibriating each from scratch
+  // arguments::
+  // templ  : generator whose particle system, number of particles
+  //          and time gap are used
+  // seed   : seed passed to the bootstrap RNG for re-randomizing
+  basic_rng(const basic_rng& templ, unsigned long seed);
+
+  // constructors restoring a generator from a snapshot stream or
+  // file written by save, without equilibriating a particle system
+  basic_rng(restore_t, std::istream& in);
+  basic_rng(restore_t, const std::string& path);
 
   // random number generation calls
   // ------------------------------
 
   // generates a random real uniformly distributed in (0,1]
-  double uniform();
+  real_type uniform();
 
   // generates a random real normally distributed with
   // mean 0 and variance 1
-  double normal();
+  real_type normal();
 
   // generates a random real exponentially distributed as exp(-x)
   // where x lies in [0,inf)
-  double exp();
+  real_type exp();
+
+  // UniformRandomBitGenerator interface
+  // -----------------------------------
+  // each random 64-bit integer is made up of the leading bits of the
+  // coordinates sampled as successive uniform variates, so that integer
+  // and uniform calls draw from the same sequence
+
+  typedef std::uint64_t result_type;
+
+  // number of bits taken from each coordinate, below the precision of
+  // the real type, and number of coordinates per 64-bit integer
+  static const unsigned bits_per_variate =
+    std::numeric_limits<real_type>::digits >= 53 ? 32 : 16;
+  static const std::size_t variates_per_result = 64 / bits_per_variate;
+
+  static constexpr result_type
+  min()
+  { return 0; }
+
+  static constexpr result_type
+  max()
+  { return ~result_type(0); }
+
+  // generates a random integer uniformly distributed in [min(),max()]
+  result_type operator()();
+
+  // bulk random number generation calls
+  // -----------------------------------
+  // each call writes n random reals following the respective
+  // distribution to the array pointed to by out; the values are
+  // identical to those returned by n successive scalar calls
+
+  void fill_uniform(real_type* out, std::size_t n);
+  void fill_normal(real_type* out, std::size_t n);
+  void fill_exp(real_type* out, std::size_t n);
+
+  // writes n random 64-bit integers, identical to those returned
+  // by n successive calls of operator()
+  void fill_u64(result_type* out, std::size_t n);
+
+  // fused bulk call writing n uniform, n normal and n exponential
+  // variates to unif, norm and expo, e.g. for Langevin steps; each
+  // collision yields three uniform and three normal variates from the
+  // coordinates of one particle and the relative velocity, which are
+  // independent, as the periodic coordinates stay uniform whatever the
+  // velocity; the exponential variates, three per collision, come from
+  // separate collisions, as the average kinetic energy along an axis,
+  // (c^2 + w^2) / 2 in terms of the centre of mass velocity c and the
+  // relative velocity w, is correlated with w^2
+  void fill_mixed(real_type*  unif,
+                  real_type*  norm,
+                  real_type*  expo,
+                  std::size_t n);
+
+  // bulk calls for further distributions
+  // ------------------------------------
+  // the three components of the relative outgoing velocity of a
+  // collided pair, as drawn by fill_normal, are independent standard
+  // normal variates, whose sums of squares and norms follow the
+  // distributions below; each call uses whole collisions, discarding
+  // the components left over by the last. the velocities of the two
+  // particles are not both used, as they share the centre of mass
+  // velocity, which each particle carries on to its next collision
+
+  // chi-square distribution with k degrees of freedom
+  void fill_chi_squared(real_type* out, std::size_t n, unsigned k);
+
+  // gamma distribution with unit scale and a shape whose double is a
+  // positive integer, i.e. an integer or half-integer shape
+  void fill_gamma(real_type* out, std::size_t n, double shape);
+
+  // Maxwell-Boltzmann distribution of the speed of a particle whose
+  // velocity components have unit variance
+  void fill_maxwell(real_type* out, std::size_t n);
+
+  // Rayleigh distribution with unit scale
+  void fill_rayleigh(real_type* out, std::size_t n);
+
+  // writes the 3 n components of n unit vectors, uniformly distributed
+  // on the sphere, to out
+  void fill_unit_vectors(real_type* out, std::size_t n);
+
+  // instrumentation
+  // ---------------
+  // counters of collisions, parameter epochs, position sweeps and buffer
+  // refills, and cycles spent in position sweeps and collisions, since
+  // construction or the last reset_stats; they are only maintained if
+  // MD_RNG_STATS, or MD_RNG_STATS_TIMING for the cycles, is defined, see
+  // rng_stats.h, and are zero otherwise
+
+  rng_stats stats() const;
+  void reset_stats();
+
+  // buffering
+  // ---------
+  // the scalar calls serve the variates of each distribution from a
+  // buffer, which is refilled by buffer_depth() consecutive collisions
+  // at a time, 1 by default; deeper buffers reduce the overhead of a
+  // scalar call to a compare and a load, and are refilled by batches of
+  // collisions as in the bulk calls. the depth doesn't change the
+  // sequence of each distribution, but the sequences drawn by scalar
+  // calls of different distributions in turn differ between depths;
+  // set_buffer_depth discards the values left in the buffers, and the
+  // depth is saved in snapshots. the depth is at most max_buffer_depth,
+  // which bounds the buffers allocated when a snapshot is loaded
+
+  static const std::size_t max_buffer_depth = 65536;
+
+  std::size_t buffer_depth() const;
+  void set_buffer_depth(std::size_t collisions);
+
+  // prefetching
+  // -----------
+  // each collision hints the processor to fetch the particles of the
+  // pair prefetch_distance() pairs ahead in the current epoch, so that
+  // collisions in particle systems exceeding the caches may overlap
+  // their memory accesses instead of stalling on each; the distance does
+  // not change the random sequence and is not saved in snapshots. it is
+  // 0 by default, which disables prefetching
+
+  std::size_t prefetch_distance() const;
+  void set_prefetch_distance(std::size_t k);
+
+  // checkpointing
+  // -------------
+  // the complete state of the generator is saved as a binary snapshot,
+  // see snapshot.h, and a generator restored from it continues with
+  // exactly the same random sequence as the saved one
+
+  void save(std::ostream& out) const;
+  void save(const std::string& path) const;
+
+  // restore the state from a snapshot, replacing the current state,
+  // which is left unchanged if the snapshot cannot be loaded; a
+  // snapshot file is memory-mapped and copied rather than read
+  void load(std::istream& in);
+  void load(const std::string& path);
 
 private:
+  // types of the particle system
+  typedef typename State::position_type        position_type;
+  typedef typename State::velocity_type        velocity_type;
+  typedef typename State::rotation_matrix_type rotation_matrix_type;
+  typedef typename State::time_step_type       time_step_type;
+
   // generates a random real uniformly distributed in (0,1]
   // note: this function is only for internal use for setting
   // random parameters private to the rng class
-  double uniform_private();
+  real_type uniform_private();
+
+  // leading bits_per_variate bits of a coordinate in [0,1]
+  static result_type
+  variate_bits(const real_type x)
+  {
+    const result_type scale = result_type(1) << bits_per_variate;
+    return static_cast<result_type>(x * static_cast<real_type>(scale)) & (scale - 1);
+  }
+
+  // calculate values of fixed parameters, which are constants
+  // if the number of particles of the particle system is
+  static constexpr std::size_t
+  calc_max_unip_buffers_filled(const std::size_t num);
+
+  static constexpr std::size_t
+  calc_max_pairs_collided(const std::size_t num);
 
-  // calculate values of fixed parameters
   std::size_t
-  calc_max_unip_buffers_filled(const std::size_t num) const;
+  max_unip_buffers_filled() const
+  { return calc_max_unip_buffers_filled(m_state.num_particles()); }
 
   std::size_t
-  calc_max_pairs_collided(const std::size_t num) const;
+  max_pairs_collided() const
+  { return calc_max_pairs_collided(m_state.num_particles()); }
 
-  // assignment of randomized parameters
+  // initialize the randomized parameters of an
+  // equilibriated particle system
+  void initialize_rand_params();
+
+  // rotation matrix of a unit quaternion drawn uniformly by xr, which
+  // rotates a template's velocities
+  MD_RNG_UNFUSED static rotation_matrix random_rotation(xoshiro256plus& xr);
+
+  // assignment of randomized parameters; the rotation matrices are
+  // computed apart from the kernels, see MD_RNG_UNFUSED
   void refresh_unip_pool();
-  void refresh_rand_rot_matrix_params();
+  MD_RNG_UNFUSED void refresh_rand_rot_matrix_params();
   void refresh_rand_pair_select_params();
   void refresh_rand_params();
   void refresh_collision_pair();
 
+  // collide the next pair of particles
+  void collide_pair(const bool update_positions);
+
+  // collide the next batch_width pairs of particles together, storing
+  // their indices in idx_a and idx_b; only valid if the pair selection
+  // scheme reports the batches of the current parameter epoch to be
+  // disjoint and the pairs lie within that epoch
+  void collide_batch(std::size_t* idx_a,
+                     std::size_t* idx_b,
+                     const bool   update_positions);
+
+  // write the variates sampled from the collision of a pair to out
+  template <variate V>
+  void store_variates(real_type*        out,
+                      const std::size_t idx_a,
+                      const std::size_t idx_b) const;
+
+  // collide num_pairs pairs, storing their variates directly to out,
+  // by collide_and_store compiled for the active instruction set
+  template <variate V>
+  void store_collisions(real_type* out, std::size_t num_pairs);
+
+  template <variate V>
+  void collide_and_store(real_type* out, std::size_t num_pairs);
+
+  // write n variates to out, first serving the values left unused in
+  // the buffer, then storing whole refills directly to out
+  template <variate V>
+  void fill_variates(real_type*              out,
+                     std::size_t             n,
+                     std::vector<real_type>& buffer,
+                     std::size_t&            num_used);
+
+  // number of velocity components stored per block by the samplers
+  // of further distributions, a whole number of collisions
+  static const std::size_t comp_block = 128 * 2 * dim;
+
+  // write n sums of squares of k velocity components, times scale,
+  // to out
+  void fill_sum_squares(real_type*      out,
+                        std::size_t     n,
+                        const unsigned  k,
+                        const real_type scale);
+
+  // conversion of the generator parameters and progress
+  // from and to a snapshot header; bytes_left is the length of the
+  // snapshot after the header, as far as known, which has to hold
+  // the particle records
+  snapshot_header make_snapshot_header() const;
+  void restore_snapshot_header(const snapshot_header& h, std::uint64_t bytes_left);
+
+  // decode a snapshot into the generator, which is left inconsistent
+  // if that throws; load decodes into a new generator and moves it in
+  void read_snapshot(std::istream& in);
+  void read_snapshot(const std::string& path);
+
+  // prefetch the particles of the n pairs prefetch distance pairs
+  // ahead of pair k of the current epoch, as far as within the epoch
+  void prefetch_pairs(std::size_t k, std::size_t n) const;
+
+  // number of values held by the buffers of the scalar calls, which
+  // follow the particle records in snapshots of deep buffers
+  std::size_t
+  snapshot_buffer_size() const
+  {
+    return m_buffer_depth == 1 ? 0 :
+      m_unif_buffer.size() + m_norm_buffer.size() + m_expo_buffer.size();
+  }
+
   // refill RNG buffers
   void refill_unip_buffer();
-  void refill_unif_buffer();
-  void refill_norm_buffer();
-  void refill_expo_buffer();
+
+  template <variate V>
+  void refill_buffer(real_type* buffer);
 
   // particle system which acts as the RNG state
-  rng_state m_state;
+  State m_state;
 
-  // buffers for storing multiple random numbers
-  // generated during one collision process
-  std::array<double, 2 * dim> m_unip_buffer;
-  std::array<double, 1 * dim> m_norm_buffer;
-  std::array<double, 2 * dim> m_unif_buffer;
-  std::array<double, 1 * dim> m_expo_buffer;
+  // buffers for storing multiple random numbers generated during
+  // one collision process for internal use, and during buffer depth
+  // collision processes for the scalar calls
+  std::array<real_type, 2 * dim> m_unip_buffer;
+  std::vector<real_type> m_norm_buffer = std::vector<real_type>(1 * dim);
+  std::vector<real_type> m_unif_buffer = std::vector<real_type>(2 * dim);
+  std::vector<real_type> m_expo_buffer = std::vector<real_type>(1 * dim);
+  std::size_t            m_buffer_depth = 1;
 
-  // counts of random numbers used from each buffer
+  // counts of random numbers used from each buffer; a count equal
+  // to the size of the buffer of a scalar call marks it as empty
   std::size_t m_num_unips_used = 0;
-  std::size_t m_num_norms_used = 0;
-  std::size_t m_num_unifs_used = 0;
-  std::size_t m_num_expos_used = 0;
+  std::size_t m_num_norms_used = 1 * dim;
+  std::size_t m_num_unifs_used = 2 * dim;
+  std::size_t m_num_expos_used = 1 * dim;
 
   // count of buffers used up during internal
   // uniform RNG process, determines when the
   // internal RNG pool should be refreshed
-  const std::size_t m_max_unip_buffers_filled;
   std::size_t m_num_unip_buffers_filled = 0;
 
   // 3D rotation matrix for pair collision 
-  rotation_matrix m_rot_matrix;
+  rotation_matrix_type m_rot_matrix;
 
   // count of pairs collided during RNG process,
   // determines when a new set of randomized
   // parameters must be brought in
-  const std::size_t m_max_pairs_collided;
   std::size_t m_num_pairs_collided = 0;
 
-  // collision pair selection scheme and parameters
-  std::size_t m_start = 0;
-  std::size_t m_shift = 0;
-  std::size_t m_jump  = 0;
+  // collision pair selection scheme and its parameters, which tell
+  // whether any batch_width consecutive pairs of the current epoch are
+  // pairwise disjoint, so that they can be collided together without
+  // changing the result
+  Pairs m_pairs;
+
+  // number of pairs collided together in a batch by the bulk calls
+  static const std::size_t batch_width = 8;
+
+  // pairs prefetched ahead of each collision
+  std::size_t m_prefetch_distance = 0;
 
   // indices of particle pair used for most recent collision
-  std::size_t m_idx_a;
-  std::size_t m_idx_b;
+  std::size_t m_idx_a = 0;
+  std::size_t m_idx_b = 0;
 
   // time gap between consecutive collisions
-  const double m_dt;
+  time_step_type m_dt = time_step_type();
+
+  // counters of internal events, see stats; the member is kept whether
+  // or not they are maintained, so that the layout of a generator does
+  // not depend on MD_RNG_STATS
+  rng_stats m_stats;
 };
 
+// molecular dice RNG with the default particle system
+typedef basic_rng<rng_state> rng;
+
+// molecular dice RNG generating single precision random variates
+typedef basic_rng<basic_rng_state<aos_layout, float>> rng_float;
+
+// molecular dice RNG with the cache-aware pair selection scheme
+typedef basic_rng<rng_state, tiled_pair_selection<>> rng_tiled;
+
+// molecular dice RNG drawing its rotation matrices from uniform unit
+// quaternions, without transcendentals
+typedef basic_rng<rng_state, global_pair_selection, quaternion_rotation> rng_quaternion;
+
+// molecular dice RNGs whose particle system lies on transparent huge
+// pages, and in the arena bound by an arena_scope, see allocation.h; the
+// arena does not reuse the space of particle arrays freed before others
+// allocated after them, e.g. by loading a snapshot of another size
+typedef basic_rng<basic_rng_state<allocated_layout<aos_layout, huge_page_allocation>>> rng_huge_pages;
+typedef basic_rng<basic_rng_state<allocated_layout<aos_layout, arena_allocation>>> rng_arena;
+
 } // namespace md
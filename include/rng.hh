@@ -4,25 +4,30 @@
 #pragma once
 
 #include <iostream>
+#include <fstream>
+#include <algorithm>
+#include <vector>
 #include <stdexcept>
 #include <limits>
 #include <cmath>
 #include <random>
+#include <utility>
+#include "bootstrap.h"
 #include "equilibriate.h"
+#include "isa_dispatch.h"
 #include "rng.h"
 
 namespace md {
 
 // constructor
-rng::rng(unsigned long     seed,
-         const std::size_t num,
-         const double      dt)
-: m_max_unip_buffers_filled(calc_max_unip_buffers_filled(num)),
-  m_max_pairs_collided(calc_max_pairs_collided(num)),
-  m_dt(dt)
+template <typename State, typename Pairs, typename Rotation>
+basic_rng<State, Pairs, Rotation>::basic_rng(unsigned long     seed,
+                                   const std::size_t num,
+                                   const double      dt)
+: m_dt(dt)
 {
   // check validity of arguments
-  if (m_max_pairs_collided < 2) {
+  if (calc_max_pairs_collided(num) < 2) {
     throw std::invalid_argument("use more particles for RNG state");
   }
 
@@ -32,55 +37,168 @@ rng::rng(unsigned long     seed,
   // instantly equilibriate the particle system by
   // initializing positions and velocities of particles with
   // equilibrium distribution values using an external RNG
-  std::mt19937 xr(seed);
-  equilibriate_positions(m_state, xr);
-  equilibriate_velocities(m_state, xr);
-  m_state.update_all_pos(m_dt);
- 
+  isa_dispatch([this, seed]() {
+    std::mt19937 xr(seed);
+    equilibriate_positions(m_state, xr);
+    equilibriate_velocities(m_state, xr);
+    m_state.update_all_pos(m_dt);
+    initialize_rand_params();
+  });
+}
+
+template <typename State, typename Pairs, typename Rotation>
+basic_rng<State, Pairs, Rotation>::basic_rng(fast_start_t,
+                                   unsigned long     seed,
+                                   const std::size_t num,
+                                   const double      dt)
+: m_dt(dt)
+{
+  if (calc_max_pairs_collided(num) < 2) {
+    throw std::invalid_argument("use more particles for RNG state");
+  }
+  m_state.initialize(num);
+  isa_dispatch([this, seed]() {
+    equilibriate_fast(m_state, seed, m_dt);
+    initialize_rand_params();
+  });
+}
+
+template <typename State, typename Pairs, typename Rotation>
+basic_rng<State, Pairs, Rotation>::basic_rng(const basic_rng& templ, unsigned long seed)
+: m_state(templ.m_state),
+  m_dt(templ.m_dt)
+{
+  const std::size_t num = m_state.num_particles();
+  isa_dispatch([this, num, seed]() {
+    xoshiro256plus        xr(seed);
+    const rotation_matrix Q = random_rotation(xr);
+
+    // translate all positions and rotate all velocities, which keeps
+    // the particle system in equilibrium
+    const real_type tx = static_cast<real_type>(xr.uniform());
+    const real_type ty = static_cast<real_type>(xr.uniform());
+    const real_type tz = static_cast<real_type>(xr.uniform());
+    for (std::size_t i = 0; i < num; i++) {
+      m_state.pos(i).x = periodic_wrap(m_state.pos(i).x + tx);
+      m_state.pos(i).y = periodic_wrap(m_state.pos(i).y + ty);
+      m_state.pos(i).z = periodic_wrap(m_state.pos(i).z + tz);
+      set_velocity(m_state, i, Q * get_velocity(m_state, i));
+    }
+
+    // decorrelate from the template by colliding half as many pairs
+    // as there are particles, with randomized parameters drawn from
+    // the translated positions
+    initialize_rand_params();
+  });
+  real_type scratch[64 * 2 * dim];
+  for (std::size_t k = 0; k < num / 2; k += 64) {
+    fill_uniform(scratch, 64 * 2 * dim);
+  }
+}
+
+template <typename State, typename Pairs, typename Rotation>
+basic_rng<State, Pairs, Rotation>::basic_rng(restore_t, std::istream& in)
+{
+  read_snapshot(in);
+}
+
+template <typename State, typename Pairs, typename Rotation>
+basic_rng<State, Pairs, Rotation>::basic_rng(restore_t, const std::string& path)
+{
+  read_snapshot(path);
+}
+
+// initialize the randomized parameters of an
+// equilibriated particle system
+template <typename State, typename Pairs, typename Rotation>
+void
+basic_rng<State, Pairs, Rotation>::initialize_rand_params()
+{
   // fill internal uniform RNG buffer and use
   // it to initialize randomized parameters
   refresh_rand_rot_matrix_params();
   refresh_rand_pair_select_params();
+  return;
+}
+
+template <typename State, typename Pairs, typename Rotation>
+rotation_matrix
+basic_rng<State, Pairs, Rotation>::random_rotation(xoshiro256plus& xr)
+{
+  ziggurat_normal normal;
+  const double qw = normal(xr);
+  const double qx = normal(xr);
+  const double qy = normal(xr);
+  const double qz = normal(xr);
+  const double s  = 2. / (qw * qw + qx * qx + qy * qy + qz * qz);
+  rotation_matrix Q;
+  Q.xx = 1. - s * (qy * qy + qz * qz);
+  Q.xy = s * (qx * qy - qz * qw);
+  Q.xz = s * (qx * qz + qy * qw);
+  Q.yx = s * (qx * qy + qz * qw);
+  Q.yy = 1. - s * (qx * qx + qz * qz);
+  Q.yz = s * (qy * qz - qx * qw);
+  Q.zx = s * (qx * qz - qy * qw);
+  Q.zy = s * (qy * qz + qx * qw);
+  Q.zz = 1. - s * (qx * qx + qy * qy);
+  return Q;
 }
 
 // random number generation calls
 // ------------------------------
 // in each case, the RNG call refills it's respective buffer with new values
 // if all values present in the buffer have been used up; then serves the
-// first unused value in the buffer
+// first unused value in the buffer. the buffers of the scalar calls are
+// empty rather than unfilled to begin with, so that a single compare
+// guards the common path
 
-double
-rng::uniform()
+template <typename State, typename Pairs, typename Rotation>
+typename basic_rng<State, Pairs, Rotation>::real_type
+basic_rng<State, Pairs, Rotation>::uniform()
 {
-  if (m_num_unifs_used == 0 or m_num_unifs_used >= m_unif_buffer.size()) {
-    refill_unif_buffer();
+  if (m_num_unifs_used >= m_unif_buffer.size()) {
+    refill_buffer<variate::unif>(m_unif_buffer.data());
     m_num_unifs_used = 0;
   }
   return m_unif_buffer[m_num_unifs_used++];
 }
 
-double
-rng::normal()
+template <typename State, typename Pairs, typename Rotation>
+typename basic_rng<State, Pairs, Rotation>::real_type
+basic_rng<State, Pairs, Rotation>::normal()
 {
-  if (m_num_norms_used == 0 or m_num_norms_used >= m_norm_buffer.size()) {
-    refill_norm_buffer();
+  if (m_num_norms_used >= m_norm_buffer.size()) {
+    refill_buffer<variate::norm>(m_norm_buffer.data());
     m_num_norms_used = 0;
   }
   return m_norm_buffer[m_num_norms_used++];
 }
 
-double
-rng::exp()
+template <typename State, typename Pairs, typename Rotation>
+typename basic_rng<State, Pairs, Rotation>::real_type
+basic_rng<State, Pairs, Rotation>::exp()
 {
-  if (m_num_expos_used == 0 or m_num_expos_used >= m_expo_buffer.size()) {
-    refill_expo_buffer();
+  if (m_num_expos_used >= m_expo_buffer.size()) {
+    refill_buffer<variate::expo>(m_expo_buffer.data());
     m_num_expos_used = 0;
   }
   return m_expo_buffer[m_num_expos_used++];
 }
 
-double
-rng::uniform_private()
+template <typename State, typename Pairs, typename Rotation>
+typename basic_rng<State, Pairs, Rotation>::result_type
+basic_rng<State, Pairs, Rotation>::operator()()
+{
+  result_type bits = 0;
+  for (std::size_t k = 0; k < variates_per_result; k++) {
+    bits = (bits << bits_per_variate) | variate_bits(uniform());
+  }
+  return bits;
+}
+
+template <typename State, typename Pairs, typename Rotation>
+typename basic_rng<State, Pairs, Rotation>::real_type
+basic_rng<State, Pairs, Rotation>::uniform_private()
 {
   if (m_num_unips_used == 0 or m_num_unips_used >= m_unip_buffer.size()) {
     refill_unip_buffer();
@@ -91,16 +209,18 @@ rng::uniform_private()
 
 // calculate values of constant parameters
 // ---------------------------------------
-std::size_t
-rng::calc_max_unip_buffers_filled(const std::size_t num) const
+template <typename State, typename Pairs, typename Rotation>
+constexpr std::size_t
+basic_rng<State, Pairs, Rotation>::calc_max_unip_buffers_filled(const std::size_t num)
 {
-  return (dim * num) / m_unip_buffer.size();
+  return (dim * num) / (2 * dim);
 }
 
-std::size_t
-rng::calc_max_pairs_collided(const std::size_t num) const
+template <typename State, typename Pairs, typename Rotation>
+constexpr std::size_t
+basic_rng<State, Pairs, Rotation>::calc_max_pairs_collided(const std::size_t num)
 {
-  return num / 8;
+  return Pairs::calc_epoch_pairs(num);
 }
 
 // assignment of randomized parameters
@@ -110,51 +230,36 @@ rng::calc_max_pairs_collided(const std::size_t num) const
 // all position coordinates have already been used as random
 // numbers, so that the new updated positions can be used as a
 // source of uniform real RNGs for the private uniform RNG
+template <typename State, typename Pairs, typename Rotation>
 void
-rng::refresh_unip_pool()
+basic_rng<State, Pairs, Rotation>::refresh_unip_pool()
 {
-  if (m_num_unip_buffers_filled >= m_max_unip_buffers_filled) {
-    m_state.update_all_pos(m_dt);
+  if (m_num_unip_buffers_filled >= max_unip_buffers_filled()) {
+    MD_RNG_COUNT(unip_sweeps, 1);
+    MD_RNG_PROBE(sweep_cycles);
+    isa_dispatch([this]() { m_state.update_all_pos(m_dt); });
     m_num_unip_buffers_filled = 0;
   }
   return;
 }
 
-// fill elements of the 3D rotation matrix with
-// values corresponding to a random triplet of
-// Eulerian angles
+// draw the 3D rotation matrix of the next epoch
+// according to the rotation source
+template <typename State, typename Pairs, typename Rotation>
 void
-rng::refresh_rand_rot_matrix_params()
+basic_rng<State, Pairs, Rotation>::refresh_rand_rot_matrix_params()
 {
-  const double alpha    = 2. * M_PI * uniform_private();
-  const double theta    = 1. * M_PI * uniform_private();
-  const double phi      = 2. * M_PI * uniform_private();
-  const double nx       = std::sin(theta) * std::cos(phi);
-  const double ny       = std::sin(theta) * std::sin(phi);
-  const double nz       = std::cos(theta);
-  const double defl_cos = std::cos(alpha); 
-  const double defl_sin = std::sin(alpha); 
-  m_rot_matrix.xx       = 0.5 * (nx * nx * (1. - defl_cos) + 1. * defl_cos);
-  m_rot_matrix.xy       = 0.5 * (nx * ny * (1. - defl_cos) - nz * defl_sin);
-  m_rot_matrix.xz       = 0.5 * (nx * nz * (1. - defl_cos) + ny * defl_sin);
-  m_rot_matrix.yx       = 0.5 * (ny * nx * (1. - defl_cos) + nz * defl_sin);
-  m_rot_matrix.yy       = 0.5 * (ny * ny * (1. - defl_cos) + 1. * defl_cos);
-  m_rot_matrix.yz       = 0.5 * (ny * nz * (1. - defl_cos) - nx * defl_sin);
-  m_rot_matrix.zx       = 0.5 * (nz * nx * (1. - defl_cos) - ny * defl_sin);
-  m_rot_matrix.zy       = 0.5 * (nz * ny * (1. - defl_cos) + nx * defl_sin);
-  m_rot_matrix.zz       = 0.5 * (nz * nz * (1. - defl_cos) + 1. * defl_cos);
+  Rotation::draw(m_rot_matrix, [this]() { return uniform_private(); });
   return;
 }
 
 // assign randomized values to collision pair selection parameters
 // according to the pair selection scheme
+template <typename State, typename Pairs, typename Rotation>
 void
-rng::refresh_rand_pair_select_params()
+basic_rng<State, Pairs, Rotation>::refresh_rand_pair_select_params()
 {
-  const std::size_t num = m_state.num_particles();
-  m_start = static_cast<int>(uniform_private() * num);
-  m_shift = static_cast<int>(uniform_private() * (num / (m_max_pairs_collided - 1.) - 1.)) + 1;
-  m_jump  = static_cast<int>(uniform_private() * (num - 1)) + 1;
+  m_pairs.refresh(m_state, [this]() { return uniform_private(); }, batch_width);
   return;
 }
 
@@ -162,27 +267,46 @@ rng::refresh_rand_pair_select_params()
 // with a new set of randomized values if the maximum threshold
 // for number of pairs collided in the process of random number
 // generation has been exceeded
+template <typename State, typename Pairs, typename Rotation>
 void
-rng::refresh_rand_params()
+basic_rng<State, Pairs, Rotation>::refresh_rand_params()
 {
-  if (m_num_pairs_collided >= m_max_pairs_collided) {
+  if (m_num_pairs_collided >= max_pairs_collided()) {
+    MD_RNG_COUNT(epochs, 1);
     refresh_rand_rot_matrix_params();
     refresh_rand_pair_select_params();
     m_num_pairs_collided = 0;
+    prefetch_pairs(0, m_prefetch_distance);
   }
   return;
 }
 
 // set indices for a new pair of particles which will be used
 // for the next collision event
+template <typename State, typename Pairs, typename Rotation>
 void
-rng::refresh_collision_pair()
+basic_rng<State, Pairs, Rotation>::refresh_collision_pair()
 {
-  const std::size_t num = m_state.num_particles();
-  m_idx_a  = m_start + m_num_pairs_collided * m_shift;
-  m_idx_a -= num * (m_idx_a >= num);
-  m_idx_b  = m_idx_a + m_jump;
-  m_idx_b -= num * (m_idx_b >= num);
+  m_pairs.select(m_state, m_num_pairs_collided, m_idx_a, m_idx_b);
+  return;
+}
+
+// the pairs of an epoch are known from its start, but the pairs of the
+// next epoch only after its parameters are drawn, which then prefetches
+// its first pairs
+template <typename State, typename Pairs, typename Rotation>
+void
+basic_rng<State, Pairs, Rotation>::prefetch_pairs(const std::size_t k,
+                                        const std::size_t n) const
+{
+  const std::size_t end = std::min(k + n, max_pairs_collided());
+  for (std::size_t l = k; l < end; l++) {
+    std::size_t idx_a;
+    std::size_t idx_b;
+    m_pairs.select(m_state, l, idx_a, idx_b);
+    m_state.prefetch(idx_a);
+    m_state.prefetch(idx_b);
+  }
   return;
 }
 
@@ -191,10 +315,12 @@ rng::refresh_collision_pair()
 
 // sample position coordinates of two successive particles
 // as uniformly distributed random variates for internal use
+template <typename State, typename Pairs, typename Rotation>
 void
-rng::refill_unip_buffer()
+basic_rng<State, Pairs, Rotation>::refill_unip_buffer()
 {
   refresh_unip_pool();
+  MD_RNG_COUNT(unip_refills, 1);
   const std::size_t idx_a = 2 * m_num_unip_buffers_filled + 0;
   const std::size_t idx_b = 2 * m_num_unip_buffers_filled + 1;
   m_num_unip_buffers_filled++;
@@ -208,56 +334,735 @@ rng::refill_unip_buffer()
   return;
 }
 
-// sample position coordinates of collided particle pair
-// as uniformly distributed random variates
+// collide the next pair of particles selected by the pair
+// selection scheme, positions of the pair are advanced only
+// when they are to be sampled as uniform variates
+template <typename State, typename Pairs, typename Rotation>
 void
-rng::refill_unif_buffer()
+basic_rng<State, Pairs, Rotation>::collide_pair(const bool update_positions)
 {
-  refresh_rand_params();
+  MD_RNG_COUNT(collisions, 1);
+  MD_RNG_COUNT(position_collisions, update_positions);
+  MD_RNG_PROBE(collision_cycles);
+  if (m_prefetch_distance != 0) {
+    prefetch_pairs(m_num_pairs_collided + m_prefetch_distance, 1);
+  }
   refresh_collision_pair();
-  m_state.update(m_rot_matrix, m_idx_a, m_idx_b, true, m_dt);
+  m_state.update(m_rot_matrix, m_idx_a, m_idx_b, update_positions, m_dt);
   m_num_pairs_collided++;
+  return;
+}
 
-  m_unif_buffer[0] = m_state.pos(m_idx_a).x;
-  m_unif_buffer[1] = m_state.pos(m_idx_a).y;
-  m_unif_buffer[2] = m_state.pos(m_idx_a).z;
-  m_unif_buffer[3] = m_state.pos(m_idx_b).x;
-  m_unif_buffer[4] = m_state.pos(m_idx_b).y;
-  m_unif_buffer[5] = m_state.pos(m_idx_b).z;
+// collide the next batch of pairs; as the pairs are disjoint, colliding
+// them together gives the same state as colliding them one at a time
+template <typename State, typename Pairs, typename Rotation>
+void
+basic_rng<State, Pairs, Rotation>::collide_batch(std::size_t* idx_a,
+                                       std::size_t* idx_b,
+                                       const bool   update_positions)
+{
+  MD_RNG_COUNT(collisions, batch_width);
+  MD_RNG_COUNT(position_collisions, update_positions * batch_width);
+  MD_RNG_PROBE(collision_cycles);
+  if (m_prefetch_distance != 0) {
+    prefetch_pairs(m_num_pairs_collided + m_prefetch_distance, batch_width);
+  }
+  for (std::size_t l = 0; l < batch_width; l++) {
+    refresh_collision_pair();
+    idx_a[l] = m_idx_a;
+    idx_b[l] = m_idx_b;
+    m_num_pairs_collided++;
+  }
+  m_state.template update_batch<batch_width>(m_rot_matrix, idx_a, idx_b,
+                                             update_positions, m_dt);
   return;
 }
 
-// sample components of relative outgoing velocity between
-// collided particle pair as normally distributed random variates
+// store the variates sampled from a collided pair:
+// position coordinates as uniformly distributed variates, components
+// of relative outgoing velocity as normally distributed variates and,
+// along each axis, the average kinetic energy as exponentially
+// distributed variates
+template <typename State, typename Pairs, typename Rotation>
+template <variate V>
 void
-rng::refill_norm_buffer()
+basic_rng<State, Pairs, Rotation>::store_variates(real_type*        out,
+                                        const std::size_t idx_a,
+                                        const std::size_t idx_b) const
 {
-  refresh_rand_params();
-  refresh_collision_pair();
-  m_state.update(m_rot_matrix, m_idx_a, m_idx_b, false, 0);
-  m_num_pairs_collided++;
-  const velocity out_vel_rel = 0.5 * (m_state.vel(m_idx_a) - m_state.vel(m_idx_b));
-  m_norm_buffer[0] = out_vel_rel.vx;
-  m_norm_buffer[1] = out_vel_rel.vy;
-  m_norm_buffer[2] = out_vel_rel.vz;
+  const position_type& pos_a = m_state.pos(idx_a);
+  const position_type& pos_b = m_state.pos(idx_b);
+  const velocity_type& vel_a = m_state.vel(idx_a);
+  const velocity_type& vel_b = m_state.vel(idx_b);
+  switch(V)
+  {
+    case variate::unif :
+      out[0] = pos_a.x;
+      out[1] = pos_a.y;
+      out[2] = pos_a.z;
+      out[3] = pos_b.x;
+      out[4] = pos_b.y;
+      out[5] = pos_b.z;
+      break;
+    case variate::norm :
+      out[0] = real_type(0.5) * (vel_a.vx - vel_b.vx);
+      out[1] = real_type(0.5) * (vel_a.vy - vel_b.vy);
+      out[2] = real_type(0.5) * (vel_a.vz - vel_b.vz);
+      break;
+    case variate::expo :
+      out[0] = real_type(0.25) * (vel_a.vx * vel_a.vx + vel_b.vx * vel_b.vx);
+      out[1] = real_type(0.25) * (vel_a.vy * vel_a.vy + vel_b.vy * vel_b.vy);
+      out[2] = real_type(0.25) * (vel_a.vz * vel_a.vz + vel_b.vz * vel_b.vz);
+      break;
+    case variate::unif_norm :
+      out[0] = pos_a.x;
+      out[1] = pos_a.y;
+      out[2] = pos_a.z;
+      out[3] = real_type(0.5) * (vel_a.vx - vel_b.vx);
+      out[4] = real_type(0.5) * (vel_a.vy - vel_b.vy);
+      out[5] = real_type(0.5) * (vel_a.vz - vel_b.vz);
+      break;
+    default :
+      break;
+  }
   return;
 }
 
-// sample, along each axis, the average kinetic energy between
-// collided particle pair as exponentially distributed random variates
+// sample, for buffer depth consecutive collisions, the position
+// coordinates of the collided pair as uniformly distributed variates,
+// the components of their relative outgoing velocity as normally
+// distributed variates, or, along each axis, their average kinetic
+// energy as exponentially distributed variates
+template <typename State, typename Pairs, typename Rotation>
+template <variate V>
 void
-rng::refill_expo_buffer()
+basic_rng<State, Pairs, Rotation>::refill_buffer(real_type* buffer)
 {
-  refresh_rand_params();
-  refresh_collision_pair();
-  m_state.update(m_rot_matrix, m_idx_a, m_idx_b, false, 0);
-  m_num_pairs_collided++;
+  switch(V)
+  {
+    case variate::unif : MD_RNG_COUNT(unif_refills, 1); break;
+    case variate::norm : MD_RNG_COUNT(norm_refills, 1); break;
+    case variate::expo : MD_RNG_COUNT(expo_refills, 1); break;
+    default            : break;
+  }
+  // a single collision is dispatched as well, so that it is computed
+  // as those of the bulk calls and of deeper buffers are
+  store_collisions<V>(buffer, m_buffer_depth);
+  return;
+}
+
+template <typename State, typename Pairs, typename Rotation>
+std::size_t
+basic_rng<State, Pairs, Rotation>::buffer_depth() const
+{
+  return m_buffer_depth;
+}
+
+template <typename State, typename Pairs, typename Rotation>
+void
+basic_rng<State, Pairs, Rotation>::set_buffer_depth(const std::size_t collisions)
+{
+  if (collisions == 0 or collisions > max_buffer_depth) {
+    throw std::invalid_argument("use a buffer depth of 1 to max_buffer_depth collisions");
+  }
+  m_buffer_depth = collisions;
+  m_unif_buffer.assign(2 * dim * collisions, real_type(0));
+  m_norm_buffer.assign(1 * dim * collisions, real_type(0));
+  m_expo_buffer.assign(1 * dim * collisions, real_type(0));
+  m_num_unifs_used = m_unif_buffer.size();
+  m_num_norms_used = m_norm_buffer.size();
+  m_num_expos_used = m_expo_buffer.size();
+  return;
+}
+
+// bulk random number generation calls
+// -----------------------------------
+// the sequence of collisions is the same as that of the scalar calls,
+// but the variates of each collision are written straight to the
+// output array, and the randomized parameters are checked once per
+// run of collisions sharing them rather than once per collision; within
+// such a run, batches of disjoint pairs are collided together
+
+template <typename State, typename Pairs, typename Rotation>
+template <variate V>
+void
+basic_rng<State, Pairs, Rotation>::fill_variates(real_type*              out,
+                                       std::size_t             n,
+                                       std::vector<real_type>& buffer,
+                                       std::size_t&            num_used)
+{
+  // serve values left unused in the buffer by earlier scalar calls
+  const std::size_t buffer_size = buffer.size();
+  while (n > 0 and num_used < buffer_size) {
+    *out++ = buffer[num_used++];
+    n--;
+  }
+
+  // store the collisions of whole refills directly to the output
+  store_collisions<V>(out, (n / buffer_size) * m_buffer_depth);
+  out += (n / buffer_size) * buffer_size;
+
+  // serve the remaining values through the buffer so that
+  // subsequent scalar calls continue the same sequence
+  const std::size_t num_rem = n % buffer_size;
+  if (num_rem > 0) {
+    refill_buffer<V>(buffer.data());
+    std::copy(buffer.begin(), buffer.begin() + num_rem, out);
+    num_used = num_rem;
+  }
+  return;
+}
+
+template <typename State, typename Pairs, typename Rotation>
+template <variate V>
+void
+basic_rng<State, Pairs, Rotation>::store_collisions(real_type* out, std::size_t num_pairs)
+{
+  isa_dispatch([this, out, num_pairs]() {
+    this->template collide_and_store<V>(out, num_pairs);
+  });
+  return;
+}
+
+template <typename State, typename Pairs, typename Rotation>
+template <variate V>
+void
+basic_rng<State, Pairs, Rotation>::collide_and_store(real_type* out, std::size_t num_pairs)
+{
+  // number of variates stored per collision, and whether
+  // positions are sampled and have to be advanced
+  const std::size_t pair_size = (V == variate::norm or V == variate::expo) ? dim : 2 * dim;
+  const bool        positions = (V == variate::unif or V == variate::unif_norm);
+  while (num_pairs > 0) {
+    refresh_rand_params();
+    const std::size_t num_epoch_pairs =
+      std::min(num_pairs, max_pairs_collided() - m_num_pairs_collided);
+    std::size_t k = 0;
+    if (m_pairs.batch_disjoint()) {
+      std::size_t idx_a[batch_width];
+      std::size_t idx_b[batch_width];
+      for (; k + batch_width <= num_epoch_pairs; k += batch_width) {
+        collide_batch(idx_a, idx_b, positions);
+        for (std::size_t l = 0; l < batch_width; l++) {
+          store_variates<V>(out, idx_a[l], idx_b[l]);
+          out += pair_size;
+        }
+      }
+    }
+    for (; k < num_epoch_pairs; k++) {
+      collide_pair(positions);
+      store_variates<V>(out, m_idx_a, m_idx_b);
+      out += pair_size;
+    }
+    num_pairs -= num_epoch_pairs;
+  }
+  return;
+}
+
+template <typename State, typename Pairs, typename Rotation>
+void
+basic_rng<State, Pairs, Rotation>::fill_uniform(real_type* out, std::size_t n)
+{
+  fill_variates<variate::unif>(out, n, m_unif_buffer, m_num_unifs_used);
+  return;
+}
+
+template <typename State, typename Pairs, typename Rotation>
+void
+basic_rng<State, Pairs, Rotation>::fill_normal(real_type* out, std::size_t n)
+{
+  fill_variates<variate::norm>(out, n, m_norm_buffer, m_num_norms_used);
+  return;
+}
+
+template <typename State, typename Pairs, typename Rotation>
+void
+basic_rng<State, Pairs, Rotation>::fill_exp(real_type* out, std::size_t n)
+{
+  fill_variates<variate::expo>(out, n, m_expo_buffer, m_num_expos_used);
+  return;
+}
+
+// the chunks of variates are stored in blocks of whole collisions,
+// first those of the uniform and normal variates, then those of the
+// exponential variates
+template <typename State, typename Pairs, typename Rotation>
+void
+basic_rng<State, Pairs, Rotation>::fill_mixed(real_type*  unif,
+                                    real_type*  norm,
+                                    real_type*  expo,
+                                    std::size_t n)
+{
+  const std::size_t block_pairs = 128;
+  real_type un[block_pairs * 2 * dim];
+  real_type ex[block_pairs * dim];
+  while (n > 0) {
+    const std::size_t m         = std::min(n, block_pairs * dim);
+    const std::size_t num_pairs = (m + dim - 1) / dim;
+    store_collisions<variate::unif_norm>(un, num_pairs);
+    store_collisions<variate::expo>(ex, num_pairs);
+    for (std::size_t i = 0; i < m; i++) {
+      const std::size_t k = i / dim;
+      const std::size_t c = i % dim;
+      unif[i] = un[2 * dim * k + c];
+      norm[i] = un[2 * dim * k + dim + c];
+      expo[i] = ex[i];
+    }
+    unif += m;
+    norm += m;
+    expo += m;
+    n    -= m;
+  }
+  return;
+}
+
+// further distributions
+// ---------------------
+// the components of the relative velocity are stored in blocks of whole
+// collisions, from which the variates are formed without further calls
+
+template <typename State, typename Pairs, typename Rotation>
+void
+basic_rng<State, Pairs, Rotation>::fill_sum_squares(real_type*      out,
+                                          std::size_t     n,
+                                          const unsigned  k,
+                                          const real_type scale)
+{
+  real_type z[comp_block];
+  const std::size_t comps_per_pair = dim;
+  while (n > 0) {
+    if (k <= comp_block) {
+      const std::size_t m = std::min(n, comp_block / k);
+      store_collisions<variate::norm>(z, (m * k + comps_per_pair - 1) / comps_per_pair);
+      for (std::size_t i = 0; i < m; i++) {
+        real_type sum = 0;
+        for (std::size_t j = 0; j < k; j++) {
+          sum += z[i * k + j] * z[i * k + j];
+        }
+        out[i] = scale * sum;
+      }
+      out += m;
+      n   -= m;
+    } else {
+      // a single variate from several blocks
+      real_type sum = 0;
+      for (std::size_t left = k; left > 0; ) {
+        const std::size_t c = std::min(left, std::size_t(comp_block));
+        store_collisions<variate::norm>(z, (c + comps_per_pair - 1) / comps_per_pair);
+        for (std::size_t j = 0; j < c; j++) {
+          sum += z[j] * z[j];
+        }
+        left -= c;
+      }
+      *out++ = scale * sum;
+      n--;
+    }
+  }
+  return;
+}
+
+template <typename State, typename Pairs, typename Rotation>
+void
+basic_rng<State, Pairs, Rotation>::fill_chi_squared(real_type* out, std::size_t n, unsigned k)
+{
+  if (k == 0) {
+    throw std::invalid_argument("use a positive number of degrees of freedom");
+  }
+  fill_sum_squares(out, n, k, real_type(1));
+  return;
+}
+
+// the sum of squares of 2 a standard normal variates is chi-square
+// distributed with 2 a degrees of freedom, half of which is gamma
+// distributed with shape a
+template <typename State, typename Pairs, typename Rotation>
+void
+basic_rng<State, Pairs, Rotation>::fill_gamma(real_type* out, std::size_t n, double shape)
+{
+  // the range is checked before the cast, which is undefined otherwise
+  const double k = 2 * shape;
+  if (not (k >= 1 and k <= std::numeric_limits<unsigned>::max()) or
+      k != static_cast<unsigned>(k)) {
+    throw std::invalid_argument("use an integer or half-integer positive shape");
+  }
+  fill_sum_squares(out, n, static_cast<unsigned>(k), real_type(0.5));
+  return;
+}
+
+template <typename State, typename Pairs, typename Rotation>
+void
+basic_rng<State, Pairs, Rotation>::fill_maxwell(real_type* out, std::size_t n)
+{
+  real_type z[comp_block];
+  while (n > 0) {
+    const std::size_t m = std::min(n, comp_block / dim);
+    store_collisions<variate::norm>(z, m);
+    for (std::size_t i = 0; i < m; i++) {
+      const real_type* v = z + dim * i;
+      out[i] = std::sqrt(v[0] * v[0] + v[1] * v[1] + v[2] * v[2]);
+    }
+    out += m;
+    n   -= m;
+  }
+  return;
+}
+
+template <typename State, typename Pairs, typename Rotation>
+void
+basic_rng<State, Pairs, Rotation>::fill_rayleigh(real_type* out, std::size_t n)
+{
+  real_type z[comp_block];
+  while (n > 0) {
+    const std::size_t m = std::min(n, comp_block / 2);
+    store_collisions<variate::norm>(z, (2 * m + dim - 1) / dim);
+    for (std::size_t i = 0; i < m; i++) {
+      const real_type* v = z + 2 * i;
+      out[i] = std::sqrt(v[0] * v[0] + v[1] * v[1]);
+    }
+    out += m;
+    n   -= m;
+  }
+  return;
+}
+
+// the velocity of a particle is isotropic, so that its direction
+// is uniformly distributed on the sphere
+template <typename State, typename Pairs, typename Rotation>
+void
+basic_rng<State, Pairs, Rotation>::fill_unit_vectors(real_type* out, std::size_t n)
+{
+  real_type z[comp_block];
+  while (n > 0) {
+    const std::size_t m = std::min(n, comp_block / dim);
+    store_collisions<variate::norm>(z, m);
+    for (std::size_t i = 0; i < m; i++) {
+      const real_type* v   = z + dim * i;
+      const real_type  inv = real_type(1) / std::sqrt(v[0] * v[0] + v[1] * v[1] + v[2] * v[2]);
+      out[dim * i + 0] = inv * v[0];
+      out[dim * i + 1] = inv * v[1];
+      out[dim * i + 2] = inv * v[2];
+    }
+    out += dim * m;
+    n   -= m;
+  }
+  return;
+}
 
-  const velocity vel_a = m_state.vel(m_idx_a);
-  const velocity vel_b = m_state.vel(m_idx_b);
-  m_expo_buffer[0] = 0.25 * (vel_a.vx * vel_a.vx + vel_b.vx * vel_b.vx);
-  m_expo_buffer[1] = 0.25 * (vel_a.vy * vel_a.vy + vel_b.vy * vel_b.vy);
-  m_expo_buffer[2] = 0.25 * (vel_a.vz * vel_a.vz + vel_b.vz * vel_b.vz);
+// the uniform variates are generated in blocks by fill_uniform and
+// packed into integers in the same manner as by operator()
+template <typename State, typename Pairs, typename Rotation>
+void
+basic_rng<State, Pairs, Rotation>::fill_u64(result_type* out, std::size_t n)
+{
+  const std::size_t block = 256;
+  real_type u[block * variates_per_result];
+  while (n > 0) {
+    const std::size_t m = std::min(n, block);
+    fill_uniform(u, m * variates_per_result);
+    for (std::size_t i = 0; i < m; i++) {
+      result_type bits = 0;
+      for (std::size_t k = 0; k < variates_per_result; k++) {
+        bits = (bits << bits_per_variate) | variate_bits(u[i * variates_per_result + k]);
+      }
+      out[i] = bits;
+    }
+    out += m;
+    n   -= m;
+  }
+  return;
+}
+
+// instrumentation
+// ---------------
+
+template <typename State, typename Pairs, typename Rotation>
+rng_stats
+basic_rng<State, Pairs, Rotation>::stats() const
+{ return m_stats; }
+
+template <typename State, typename Pairs, typename Rotation>
+void
+basic_rng<State, Pairs, Rotation>::reset_stats()
+{
+  m_stats = rng_stats();
+  return;
+}
+
+// prefetching
+// -----------
+
+template <typename State, typename Pairs, typename Rotation>
+std::size_t
+basic_rng<State, Pairs, Rotation>::prefetch_distance() const
+{
+  return m_prefetch_distance;
+}
+
+template <typename State, typename Pairs, typename Rotation>
+void
+basic_rng<State, Pairs, Rotation>::set_prefetch_distance(const std::size_t k)
+{
+  m_prefetch_distance = k;
+  return;
+}
+
+// checkpointing
+// -------------
+
+template <typename State, typename Pairs, typename Rotation>
+snapshot_header
+basic_rng<State, Pairs, Rotation>::make_snapshot_header() const
+{
+  snapshot_header h;
+  init_snapshot_header(h, sizeof(real_type));
+  h.dim                     = dim;
+  h.num_particles           = m_state.num_particles();
+  h.dt                      = m_dt;
+  h.max_unip_buffers_filled = max_unip_buffers_filled();
+  h.max_pairs_collided      = max_pairs_collided();
+  h.num_unips_used          = m_num_unips_used;
+  h.num_norms_used          = m_num_norms_used;
+  h.num_unifs_used          = m_num_unifs_used;
+  h.num_expos_used          = m_num_expos_used;
+  h.num_unip_buffers_filled = m_num_unip_buffers_filled;
+  h.num_pairs_collided      = m_num_pairs_collided;
+  h.idx_a                   = m_idx_a;
+  h.idx_b                   = m_idx_b;
+  h.buffer_depth            = m_buffer_depth;
+  h.rotation_source         = Rotation::snapshot_id;
+  h.fixed_point_bits        = State::fixed_point_bits;
+  m_pairs.save(h);
+  const real_type* rot = &m_rot_matrix.xx;
+  std::copy(rot, rot + 9, h.rot_matrix);
+  std::copy(m_unip_buffer.begin(), m_unip_buffer.end(), h.unip_buffer);
+  if (m_buffer_depth == 1) {
+    std::copy(m_norm_buffer.begin(), m_norm_buffer.end(), h.norm_buffer);
+    std::copy(m_unif_buffer.begin(), m_unif_buffer.end(), h.unif_buffer);
+    std::copy(m_expo_buffer.begin(), m_expo_buffer.end(), h.expo_buffer);
+  }
+  return h;
+}
+
+template <typename State, typename Pairs, typename Rotation>
+void
+basic_rng<State, Pairs, Rotation>::restore_snapshot_header(const snapshot_header& h,
+                                                 const std::uint64_t    bytes_left)
+{
+  check_snapshot_header(h, dim, sizeof(real_type));
+  const std::uint64_t record_bytes = snapshot_record_size * sizeof(real_type);
+  if (h.num_particles > max_snapshot_particles or h.num_particles > bytes_left / record_bytes) {
+    throw std::runtime_error("truncated RNG snapshot");
+  }
+  if (calc_max_pairs_collided(h.num_particles) < 2 or
+      h.max_pairs_collided != calc_max_pairs_collided(h.num_particles) or
+      h.max_unip_buffers_filled != calc_max_unip_buffers_filled(h.num_particles) or
+      h.buffer_depth == 0 or h.buffer_depth > max_buffer_depth) {
+    throw std::runtime_error("inconsistent RNG snapshot");
+  }
+  if (h.rotation_source != Rotation::snapshot_id) {
+    throw std::runtime_error("RNG snapshot of a generator with another rotation source");
+  }
+  if (h.fixed_point_bits != State::fixed_point_bits) {
+    throw std::runtime_error("RNG snapshot of a generator with another position representation");
+  }
+  m_state.initialize(h.num_particles);
+  set_buffer_depth(h.buffer_depth);
+  m_dt                      = h.dt;
+  m_num_unips_used          = h.num_unips_used;
+  m_num_unip_buffers_filled = h.num_unip_buffers_filled;
+  m_num_pairs_collided      = h.num_pairs_collided;
+  m_idx_a                   = h.idx_a;
+  m_idx_b                   = h.idx_b;
+  m_pairs.restore(h, h.num_particles);
+  if (h.idx_a >= h.num_particles or h.idx_b >= h.num_particles or
+      h.num_pairs_collided > h.max_pairs_collided or
+      h.num_unip_buffers_filled > h.max_unip_buffers_filled or
+      h.num_unips_used > m_unip_buffer.size() or
+      h.num_norms_used > m_norm_buffer.size() or
+      h.num_unifs_used > m_unif_buffer.size() or
+      h.num_expos_used > m_expo_buffer.size()) {
+    throw std::runtime_error("inconsistent RNG snapshot");
+  }
+  real_type* rot = &m_rot_matrix.xx;
+  std::copy(h.rot_matrix, h.rot_matrix + 9, rot);
+  std::copy(h.unip_buffer, h.unip_buffer + m_unip_buffer.size(), m_unip_buffer.begin());
+  if (m_buffer_depth == 1) {
+    std::copy(h.norm_buffer, h.norm_buffer + m_norm_buffer.size(), m_norm_buffer.begin());
+    std::copy(h.unif_buffer, h.unif_buffer + m_unif_buffer.size(), m_unif_buffer.begin());
+    std::copy(h.expo_buffer, h.expo_buffer + m_expo_buffer.size(), m_expo_buffer.begin());
+  }
+
+  // a buffer is never left filled but unused, so that a count of 0
+  // marks the buffers of a generator which hasn't drawn any variate
+  m_num_norms_used = h.num_norms_used != 0 ? h.num_norms_used : m_norm_buffer.size();
+  m_num_unifs_used = h.num_unifs_used != 0 ? h.num_unifs_used : m_unif_buffer.size();
+  m_num_expos_used = h.num_expos_used != 0 ? h.num_expos_used : m_expo_buffer.size();
+  return;
+}
+
+// particle records are written in blocks through a staging buffer,
+// so that any storage layout of the particle system can be saved
+template <typename State, typename Pairs, typename Rotation>
+void
+basic_rng<State, Pairs, Rotation>::save(std::ostream& out) const
+{
+  const snapshot_header h = make_snapshot_header();
+  out.write(reinterpret_cast<const char*>(&h), sizeof(h));
+
+  const std::size_t num   = m_state.num_particles();
+  const std::size_t block = 4096;
+  std::vector<real_type> records(snapshot_record_size * block);
+  for (std::size_t begin = 0; begin < num; begin += block) {
+    const std::size_t end = std::min(begin + block, num);
+    real_type* r = records.data();
+    for (std::size_t i = begin; i < end; i++) {
+      const position_type p = m_state.pos(i);
+      const velocity_type v = m_state.vel(i);
+      *r++ = p.x;
+      *r++ = p.y;
+      *r++ = p.z;
+      *r++ = v.vx;
+      *r++ = v.vy;
+      *r++ = v.vz;
+    }
+    out.write(reinterpret_cast<const char*>(records.data()),
+              (r - records.data()) * sizeof(real_type));
+  }
+  if (snapshot_buffer_size() != 0) {
+    out.write(reinterpret_cast<const char*>(m_unif_buffer.data()),
+              m_unif_buffer.size() * sizeof(real_type));
+    out.write(reinterpret_cast<const char*>(m_norm_buffer.data()),
+              m_norm_buffer.size() * sizeof(real_type));
+    out.write(reinterpret_cast<const char*>(m_expo_buffer.data()),
+              m_expo_buffer.size() * sizeof(real_type));
+  }
+  if (not out) {
+    throw std::runtime_error("cannot write RNG snapshot");
+  }
+  return;
+}
+
+template <typename State, typename Pairs, typename Rotation>
+void
+basic_rng<State, Pairs, Rotation>::save(const std::string& path) const
+{
+  std::ofstream out(path, std::ios::binary | std::ios::trunc);
+  if (not out) {
+    throw std::runtime_error("cannot open " + path);
+  }
+  save(out);
+  return;
+}
+
+// a snapshot is decoded into a new generator, so that the generator
+// is left unchanged if it is truncated or inconsistent; the prefetch
+// distance is not part of the snapshot and is kept
+template <typename State, typename Pairs, typename Rotation>
+void
+basic_rng<State, Pairs, Rotation>::load(std::istream& in)
+{
+  basic_rng restored(restore, in);
+  restored.m_prefetch_distance = m_prefetch_distance;
+  *this = std::move(restored);
+  return;
+}
+
+template <typename State, typename Pairs, typename Rotation>
+void
+basic_rng<State, Pairs, Rotation>::load(const std::string& path)
+{
+  basic_rng restored(restore, path);
+  restored.m_prefetch_distance = m_prefetch_distance;
+  *this = std::move(restored);
+  return;
+}
+
+template <typename State, typename Pairs, typename Rotation>
+void
+basic_rng<State, Pairs, Rotation>::read_snapshot(std::istream& in)
+{
+  snapshot_header h;
+  if (not in.read(reinterpret_cast<char*>(&h), sizeof(h))) {
+    throw std::runtime_error("cannot read RNG snapshot");
+  }
+  restore_snapshot_header(h, snapshot_bytes_left(in));
+
+  const std::size_t num   = m_state.num_particles();
+  const std::size_t block = 4096;
+  std::vector<real_type> records(snapshot_record_size * block);
+  for (std::size_t begin = 0; begin < num; begin += block) {
+    const std::size_t end = std::min(begin + block, num);
+    if (not in.read(reinterpret_cast<char*>(records.data()),
+                    snapshot_record_size * (end - begin) * sizeof(real_type))) {
+      throw std::runtime_error("truncated RNG snapshot");
+    }
+    const real_type* r = records.data();
+    for (std::size_t i = begin; i < end; i++) {
+      m_state.pos(i).x  = *r++;
+      m_state.pos(i).y  = *r++;
+      m_state.pos(i).z  = *r++;
+      m_state.vel(i).vx = *r++;
+      m_state.vel(i).vy = *r++;
+      m_state.vel(i).vz = *r++;
+    }
+  }
+  if (snapshot_buffer_size() != 0) {
+    if (not (in.read(reinterpret_cast<char*>(m_unif_buffer.data()),
+                     m_unif_buffer.size() * sizeof(real_type)) and
+             in.read(reinterpret_cast<char*>(m_norm_buffer.data()),
+                     m_norm_buffer.size() * sizeof(real_type)) and
+             in.read(reinterpret_cast<char*>(m_expo_buffer.data()),
+                     m_expo_buffer.size() * sizeof(real_type)))) {
+      throw std::runtime_error("truncated RNG snapshot");
+    }
+  }
+  return;
+}
+
+// the snapshot file is mapped as a whole and the particle records
+// are copied from the mapping in a single pass, or, without memory
+// mapping, the file is read as a stream
+template <typename State, typename Pairs, typename Rotation>
+void
+basic_rng<State, Pairs, Rotation>::read_snapshot(const std::string& path)
+{
+#if MD_RNG_MMAP
+  const mapped_file f(path);
+  snapshot_header h;
+  if (f.size() < sizeof(h)) {
+    throw std::runtime_error("truncated RNG snapshot " + path);
+  }
+  std::memcpy(&h, f.data(), sizeof(h));
+  restore_snapshot_header(h, f.size() - sizeof(h));
+  const std::size_t num_buffered = snapshot_buffer_size();
+  if (f.size() != sizeof(h) + (snapshot_record_size * h.num_particles + num_buffered) * sizeof(real_type)) {
+    throw std::runtime_error("truncated RNG snapshot " + path);
+  }
+
+  const real_type* r = reinterpret_cast<const real_type*>(f.data() + sizeof(h));
+  for (std::size_t i = 0; i < m_state.num_particles(); i++) {
+    m_state.pos(i).x  = r[0];
+    m_state.pos(i).y  = r[1];
+    m_state.pos(i).z  = r[2];
+    m_state.vel(i).vx = r[3];
+    m_state.vel(i).vy = r[4];
+    m_state.vel(i).vz = r[5];
+    r += snapshot_record_size;
+  }
+  if (snapshot_buffer_size() != 0) {
+    std::copy(r, r + m_unif_buffer.size(), m_unif_buffer.begin());
+    r += m_unif_buffer.size();
+    std::copy(r, r + m_norm_buffer.size(), m_norm_buffer.begin());
+    r += m_norm_buffer.size();
+    std::copy(r, r + m_expo_buffer.size(), m_expo_buffer.begin());
+  }
+#else
+  std::ifstream in(path, std::ios::binary);
+  if (not in) {
+    throw std::runtime_error("cannot open " + path);
+  }
+  read_snapshot(in);
+#endif
   return;
 }
 
@@ -0,0 +1,185 @@
+// Copyright (c) 2018 Santosh Ansumali @ JNCASR
+// See LICENSE
+
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <atomic>
+#include <memory>
+#include <mutex>
+#include <utility>
+#include <vector>
+#include "seed.h"
+#include "rng.h"
+
+namespace md {
+
+// pool handing out one generator per thread
+// -----------------------------------------
+// a thread's generator is created on its first request and is
+// constructed by that thread, so that its particle system is
+// allocated and first written by the thread which uses it; under
+// the first-touch policy of the operating system the pages of the
+// state then reside on the NUMA node local to that thread. once
+// created, the generator stays mapped to the thread for the lifetime
+// of the thread; when the thread exits, the generator is returned to
+// the pool and handed to the next thread requesting one, which copies
+// it, so that the state is again first touched by the thread using
+// it, and continues its sequence; the pool thus holds no more
+// generators than threads it served at once. the generators are
+// released when the pool is destroyed
+template <typename Rng>
+class basic_rng_pool
+{
+public:
+  // constructor
+  // arguments::
+  // seed   : base seed, the k-th generator created by the pool is
+  //          seeded with derive_seed(seed, k)
+  // num    : number of particles in the state of each generator
+  // dt     : time gap between successive collisions
+  basic_rng_pool(unsigned long     seed = 1234,
+                 const std::size_t num  = 131072,
+                 const double      dt   = 0.1)
+  : m_id(next_pool_id()),
+    m_seed(seed),
+    m_num(num),
+    m_dt(dt),
+    m_registry(std::make_shared<registry>())
+  {}
+
+  basic_rng_pool(const basic_rng_pool&) = delete;
+  basic_rng_pool& operator=(const basic_rng_pool&) = delete;
+
+  // generator owned by the calling thread
+  Rng&
+  get()
+  {
+    // generators leased to this thread, keyed by pool id; ids are never
+    // reused, so leases of destroyed pools never match
+    thread_local lease_list leases;
+    for (std::size_t i = 0; i < leases.items.size(); i++) {
+      if (leases.items[i].id == m_id) {
+        return *leases.items[i].rng;
+      }
+    }
+
+    // take a generator returned by an exited thread, or reserve an
+    // index for a new one, and construct the generator of this thread
+    // outside the lock so that threads equilibriate concurrently; a
+    // returned index whose generator failed to construct is empty
+    std::size_t index;
+    Rng*        returned = nullptr;
+    {
+      std::lock_guard<std::mutex> lock(m_registry->mutex);
+      if (not m_registry->free.empty()) {
+        index = m_registry->free.back();
+        m_registry->free.pop_back();
+        returned = m_registry->rngs[index].get();
+      } else {
+        index = m_registry->rngs.size();
+        m_registry->rngs.emplace_back();
+      }
+    }
+    std::unique_ptr<Rng> r;
+    try {
+      if (returned != nullptr) {
+        r.reset(new Rng(*returned));
+      } else {
+        r.reset(new Rng(derive_seed(m_seed, index), m_num, m_dt));
+      }
+    } catch (...) {
+      std::lock_guard<std::mutex> lock(m_registry->mutex);
+      m_registry->free.push_back(index);
+      throw;
+    }
+    Rng* p = r.get();
+    {
+      std::lock_guard<std::mutex> lock(m_registry->mutex);
+      m_registry->rngs[index].swap(r);
+    }
+    leases.items.push_back(lease{m_id, m_registry, index, p});
+    return *p;
+  }
+
+  // number of generators held by the pool
+  std::size_t
+  size() const
+  {
+    std::lock_guard<std::mutex> lock(m_registry->mutex);
+    std::size_t count = 0;
+    for (std::size_t i = 0; i < m_registry->rngs.size(); i++) {
+      count += m_registry->rngs[i] != nullptr;
+    }
+    return count;
+  }
+
+private:
+  // generators of the pool and indices of those not leased to any
+  // thread, shared with the leases so that a thread exiting after the
+  // pool was destroyed finds it gone
+  struct registry
+  {
+    std::mutex                        mutex;
+    std::vector<std::unique_ptr<Rng>> rngs;
+    std::vector<std::size_t>          free;
+  };
+
+  struct lease
+  {
+    std::uint64_t           id;
+    std::weak_ptr<registry> owner;
+    std::size_t             index;
+    Rng*                    rng;
+  };
+
+  // leases of a thread, returned to their pools when the thread exits
+  struct lease_list
+  {
+    ~lease_list()
+    {
+      for (std::size_t i = 0; i < items.size(); i++) {
+        const std::shared_ptr<registry> r = items[i].owner.lock();
+        if (r) {
+          std::lock_guard<std::mutex> lock(r->mutex);
+          r->free.push_back(items[i].index);
+        }
+      }
+    }
+
+    std::vector<lease> items;
+  };
+
+  static std::uint64_t
+  next_pool_id()
+  {
+    static std::atomic<std::uint64_t> count(0);
+    return count++;
+  }
+
+  // unique id of the pool
+  const std::uint64_t m_id;
+
+  // parameters of the generators
+  const unsigned long m_seed;
+  const std::size_t   m_num;
+  const double        m_dt;
+
+  // generators of all threads served by the pool
+  const std::shared_ptr<registry> m_registry;
+};
+
+typedef basic_rng_pool<rng> rng_pool;
+
+// generator of the calling thread from a process-wide pool with the
+// default parameters, intended for use inside hot loops
+inline rng&
+this_thread_rng()
+{
+  static rng_pool pool;
+  thread_local rng* const r = &pool.get();
+  return *r;
+}
+
+} // namespace md
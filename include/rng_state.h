@@ -4,102 +4,141 @@
 #pragma once
 
 #include <cstddef>
-#include <vector>
 #include "position.h"
 #include "velocity.h"
 #include "rotation_matrix.h"
+#include "particle_layout.h"
 
 namespace md {
 
-class rng_state
+// particle system whose positions and velocities are real numbers of
+// type Real, stored according to the given layout, see particle_layout.h
+template <typename Layout, typename Real = double>
+class basic_rng_state
 {
 public:
   // dimension of the particle system
   static const std::size_t dim = 3;
 
+  // storage layout of the particle system
+  typedef Layout                                    layout_type;
+  typedef typename Layout::template storage<Real>   storage_type;
+
+  // types of the coordinates and velocity components
+  typedef Real                                      real_type;
+  typedef basic_position<Real>                      position_type;
+  typedef basic_velocity<Real>                      velocity_type;
+  typedef basic_rotation_matrix<Real>               rotation_matrix_type;
+
+  // type of the time gap between successive collisions
+  typedef double                                    time_step_type;
+
+  typedef typename storage_type::position_reference       position_reference;
+  typedef typename storage_type::const_position_reference const_position_reference;
+  typedef typename storage_type::velocity_reference       velocity_reference;
+  typedef typename storage_type::const_velocity_reference const_velocity_reference;
+
+  // default number of particles and time gap of a generator
+  static constexpr std::size_t default_num_particles = 131072;
+  static constexpr double      default_time_step     = 0.1;
+
+  // bits of the fixed-point coordinates, 0 as the coordinates of
+  // this particle system are real numbers, see fixed_point_rng_state
+  static constexpr unsigned fixed_point_bits = 0;
+
   // constructor
-  rng_state()
+  basic_rng_state()
   { initialize(0); }
 
-  rng_state(const std::size_t num)
+  basic_rng_state(const std::size_t num)
   { initialize(num); }
 
   std::size_t
   num_particles() const
-  { return m_vel.size(); }
+  { return m_particles.size(); }
 
   // accessors for velocity and position of each particle
-  position&
+  position_reference
   pos(const std::size_t idx)
-  { return m_pos[idx]; }
+  { return m_particles.pos(idx); }
 
-  const position&
+  const_position_reference
   pos(const std::size_t idx) const
-  { return m_pos[idx]; }
+  { return m_particles.pos(idx); }
 
-  velocity&
+  velocity_reference
   vel(const std::size_t idx)
-  { return m_vel[idx]; }
+  { return m_particles.vel(idx); }
 
-  const velocity&
+  const_velocity_reference
   vel(const std::size_t idx) const
-  { return m_vel[idx]; }
+  { return m_particles.vel(idx); }
+
+  // hint the processor to fetch the records of a particle
+  void
+  prefetch(const std::size_t idx) const
+  { m_particles.prefetch(idx); }
 
   void
   initialize(const std::size_t num)
+  { m_particles.resize(num); }
+
+  // wrap a particle index lying within [0,2 num) to [0,num)
+  std::size_t
+  wrap_index(const std::size_t idx) const
   {
-    m_pos.resize(num);
-    m_vel.resize(num);
+    const std::size_t num = num_particles();
+    return idx - num * (idx >= num);
   }
 
   // wrap coordinates to lie within [0,1]
-  double
-  periodic_wrap(const double x) const
-  { return x - 1.0 * (x > 1.0) + 1.0 * (x < 0.0); }
+  Real
+  periodic_wrap(const Real x) const
+  { return md::periodic_wrap(x); }
 
   // update position of a particle
   void
-  update_pos(const std::size_t idx, const double dt)
+  update_pos(const std::size_t idx, const Real dt)
   {
-    m_pos[idx].x = periodic_wrap(m_pos[idx].x + m_vel[idx].vx * dt);
-    m_pos[idx].y = periodic_wrap(m_pos[idx].y + m_vel[idx].vy * dt);
-    m_pos[idx].z = periodic_wrap(m_pos[idx].z + m_vel[idx].vz * dt);
+    position_reference       p = pos(idx);
+    const_velocity_reference v = vel(idx);
+    p.x = periodic_wrap(p.x + v.vx * dt);
+    p.y = periodic_wrap(p.y + v.vy * dt);
+    p.z = periodic_wrap(p.z + v.vz * dt);
     return;
   }
 
   // update positions of all particles
   void
-  update_all_pos(const double dt)
+  update_all_pos(const Real dt)
   {
-    for (std::size_t i = 0; i < num_particles(); i++) {
-      update_pos(i, dt);
-    }
+    m_particles.update_all_pos(dt);
     return;
   }
 
   // update velocities of a pair of colliding particles
   void
-  update_vel(const rotation_matrix& R,
-             const std::size_t      idx_a,
-             const std::size_t      idx_b)
+  update_vel(const rotation_matrix_type& R,
+             const std::size_t           idx_a,
+             const std::size_t           idx_b)
   {
-    const velocity ua   = m_vel[idx_a];
-    const velocity ub   = m_vel[idx_b];
-    const velocity urel = ua - ub;
-    const velocity vrel = R * urel;
-    const velocity ucm  = 0.5 * (ua + ub);
-    m_vel[idx_a]        = ucm + vrel;
-    m_vel[idx_b]        = ucm - vrel;
+    const velocity_type ua   = vel(idx_a);
+    const velocity_type ub   = vel(idx_b);
+    const velocity_type urel = ua - ub;
+    const velocity_type vrel = R * urel;
+    const velocity_type ucm  = 0.5 * (ua + ub);
+    vel(idx_a)               = ucm + vrel;
+    vel(idx_b)               = ucm - vrel;
     return;
   }
 
   // update state by colliding two particles
   void
-  update(const rotation_matrix& R,
-         const std::size_t      idx_a,
-         const std::size_t      idx_b,
-         const bool             update_positions,
-         const double           dt)
+  update(const rotation_matrix_type& R,
+         const std::size_t           idx_a,
+         const std::size_t           idx_b,
+         const bool                  update_positions,
+         const Real                  dt)
   {
     update_vel(R, idx_a, idx_b);
     if (update_positions) {
@@ -109,10 +148,104 @@ public:
     return;
   }
 
+  // update velocities of a batch of W pairwise disjoint pairs of
+  // colliding particles; components are gathered into lanes so that
+  // the pairs are collided together across SIMD lanes, and the
+  // result of each pair is identical to that of update_vel
+  template <std::size_t W>
+  void
+  update_vel_batch(const rotation_matrix_type& R,
+                   const std::size_t*          idx_a,
+                   const std::size_t*          idx_b)
+  {
+    Real ax[W], ay[W], az[W];
+    Real bx[W], by[W], bz[W];
+    for (std::size_t l = 0; l < W; l++) {
+      ax[l] = vel(idx_a[l]).vx;
+      ay[l] = vel(idx_a[l]).vy;
+      az[l] = vel(idx_a[l]).vz;
+      bx[l] = vel(idx_b[l]).vx;
+      by[l] = vel(idx_b[l]).vy;
+      bz[l] = vel(idx_b[l]).vz;
+    }
+    for (std::size_t l = 0; l < W; l++) {
+      const Real urel_x = ax[l] - bx[l];
+      const Real urel_y = ay[l] - by[l];
+      const Real urel_z = az[l] - bz[l];
+      const Real vrel_x = R.xx * urel_x + R.xy * urel_y + R.xz * urel_z;
+      const Real vrel_y = R.yx * urel_x + R.yy * urel_y + R.yz * urel_z;
+      const Real vrel_z = R.zx * urel_x + R.zy * urel_y + R.zz * urel_z;
+      const Real ucm_x  = (ax[l] + bx[l]) * Real(0.5);
+      const Real ucm_y  = (ay[l] + by[l]) * Real(0.5);
+      const Real ucm_z  = (az[l] + bz[l]) * Real(0.5);
+      ax[l] = ucm_x + vrel_x;
+      ay[l] = ucm_y + vrel_y;
+      az[l] = ucm_z + vrel_z;
+      bx[l] = ucm_x - vrel_x;
+      by[l] = ucm_y - vrel_y;
+      bz[l] = ucm_z - vrel_z;
+    }
+    for (std::size_t l = 0; l < W; l++) {
+      vel(idx_a[l]).vx = ax[l];
+      vel(idx_a[l]).vy = ay[l];
+      vel(idx_a[l]).vz = az[l];
+      vel(idx_b[l]).vx = bx[l];
+      vel(idx_b[l]).vy = by[l];
+      vel(idx_b[l]).vz = bz[l];
+    }
+    return;
+  }
+
+  // update state by colliding a batch of W pairwise disjoint pairs,
+  // equivalent to W successive calls of update
+  template <std::size_t W>
+  void
+  update_batch(const rotation_matrix_type& R,
+               const std::size_t*          idx_a,
+               const std::size_t*          idx_b,
+               const bool                  update_positions,
+               const Real                  dt)
+  {
+    update_vel_batch<W>(R, idx_a, idx_b);
+    if (update_positions) {
+      update_pos_batch<W>(idx_a, dt);
+      update_pos_batch<W>(idx_b, dt);
+    }
+    return;
+  }
+
+  // update positions of a batch of W distinct particles, gathered
+  // into lanes in the same manner as update_vel_batch
+  template <std::size_t W>
+  void
+  update_pos_batch(const std::size_t* idx, const Real dt)
+  {
+    Real x[W], y[W], z[W];
+    for (std::size_t l = 0; l < W; l++) {
+      x[l] = pos(idx[l]).x + vel(idx[l]).vx * dt;
+      y[l] = pos(idx[l]).y + vel(idx[l]).vy * dt;
+      z[l] = pos(idx[l]).z + vel(idx[l]).vz * dt;
+    }
+    for (std::size_t l = 0; l < W; l++) {
+      pos(idx[l]).x = periodic_wrap(x[l]);
+      pos(idx[l]).y = periodic_wrap(y[l]);
+      pos(idx[l]).z = periodic_wrap(z[l]);
+    }
+    return;
+  }
+
+protected:
+  // storage of the particle system, for derived particle systems
+  storage_type&
+  storage()
+  { return m_particles; }
+
 private:
   // position and velocity of each particle in the system
-  std::vector<position> m_pos;
-  std::vector<velocity> m_vel;
+  storage_type m_particles;
 };
 
+// particle system with the default storage layout
+typedef basic_rng_state<aos_layout> rng_state;
+
 } // namespace md
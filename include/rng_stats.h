@@ -0,0 +1,110 @@
+// Copyright (c) 2018 Santosh Ansumali @ JNCASR
+// See LICENSE
+
+#pragma once
+
+#include <cstdint>
+
+// the timing probes imply the counters
+#if defined(MD_RNG_STATS_TIMING) && !defined(MD_RNG_STATS)
+#define MD_RNG_STATS
+#endif
+
+#ifdef MD_RNG_STATS_TIMING
+#include <chrono>
+#if defined(__x86_64__) || defined(__i386__)
+#include <x86intrin.h>
+#endif
+#endif
+
+namespace md {
+
+// counters of the internal events of a generator, see basic_rng::stats;
+// the event counters are only maintained if MD_RNG_STATS is defined
+// before including the generator, and the cycle counters only if
+// MD_RNG_STATS_TIMING is, as reading the cycle counter around every
+// scalar collision costs about as much as the collision; counters
+// which are not maintained are zero; the macros have to be defined
+// alike in all translation units of a program
+struct rng_stats
+{
+  // pair collisions, and those of them advancing the pair's positions
+  std::uint64_t collisions          = 0;
+  std::uint64_t position_collisions = 0;
+
+  // renewals of the rotation matrix and pair selection parameters,
+  // i.e. the epochs of refresh_rand_params
+  std::uint64_t epochs = 0;
+
+  // full sweeps of position updates of refresh_unip_pool
+  std::uint64_t unip_sweeps = 0;
+
+  // refills of the buffers of each distribution, and of the
+  // buffer of the uniform variates for internal use
+  std::uint64_t unif_refills = 0;
+  std::uint64_t norm_refills = 0;
+  std::uint64_t expo_refills = 0;
+  std::uint64_t unip_refills = 0;
+
+  // cycles spent in full sweeps of position updates and in pair
+  // collisions; cycles are time stamp counter ticks on x86 and
+  // nanoseconds elsewhere
+  std::uint64_t sweep_cycles     = 0;
+  std::uint64_t collision_cycles = 0;
+};
+
+#ifdef MD_RNG_STATS
+constexpr bool rng_stats_enabled = true;
+#define MD_RNG_COUNT(counter, n) (m_stats.counter += (n))
+#else
+constexpr bool rng_stats_enabled = false;
+#define MD_RNG_COUNT(counter, n) ((void) 0)
+#endif
+
+#ifdef MD_RNG_STATS_TIMING
+
+constexpr bool rng_stats_timing_enabled = true;
+
+// current value of the cycle counter of the timing probes
+inline std::uint64_t
+read_cycles()
+{
+#if defined(__x86_64__) || defined(__i386__)
+  return __rdtsc();
+#else
+  return std::chrono::duration_cast<std::chrono::nanoseconds>(
+           std::chrono::steady_clock::now().time_since_epoch()).count();
+#endif
+}
+
+// timing probe adding the cycles of its lifetime to a counter
+class cycle_probe
+{
+public:
+  explicit cycle_probe(std::uint64_t& counter)
+  : m_counter(counter),
+    m_start(read_cycles())
+  {}
+
+  ~cycle_probe()
+  { m_counter += read_cycles() - m_start; }
+
+  cycle_probe(const cycle_probe&) = delete;
+  cycle_probe& operator=(const cycle_probe&) = delete;
+
+private:
+  std::uint64_t& m_counter;
+  std::uint64_t  m_start;
+};
+
+// time the rest of the enclosing scope into a cycle counter
+#define MD_RNG_PROBE(counter) md::cycle_probe md_rng_probe_(m_stats.counter)
+
+#else
+
+constexpr bool rng_stats_timing_enabled = false;
+#define MD_RNG_PROBE(counter) ((void) 0)
+
+#endif
+
+} // namespace md
@@ -3,30 +3,36 @@
 
 #pragma once
 
+#include "velocity.h"
+
 namespace md {
 
 // matrix for rotations in 3D space
-struct rotation_matrix
+template <typename Real>
+struct basic_rotation_matrix
 {
-  double xx;
-  double xy;
-  double xz;
+  Real xx;
+  Real xy;
+  Real xz;
 
-  double yx;
-  double yy;
-  double yz;
+  Real yx;
+  Real yy;
+  Real yz;
 
-  double zx;
-  double zy;
-  double zz;
+  Real zx;
+  Real zy;
+  Real zz;
 };
 
+typedef basic_rotation_matrix<double> rotation_matrix;
+
 // result of rotating a velocity vector using the
 // rotation matrix
-velocity
-operator*(const rotation_matrix& R, const velocity& u)
+template <typename Real>
+basic_velocity<Real>
+operator*(const basic_rotation_matrix<Real>& R, const basic_velocity<Real>& u)
 {
-  velocity v;
+  basic_velocity<Real> v;
   v.vx = R.xx * u.vx + R.xy * u.vy + R.xz * u.vz;
   v.vy = R.yx * u.vx + R.yy * u.vy + R.yz * u.vz;
   v.vz = R.zx * u.vx + R.zy * u.vy + R.zz * u.vz;
@@ -0,0 +1,103 @@
+// Copyright (c) 2018 Santosh Ansumali @ JNCASR
+// See LICENSE
+
+#pragma once
+
+#include <cmath>
+#include <cstdint>
+#include "rotation_matrix.h"
+
+namespace md {
+
+// rotation sources
+// ----------------
+// at the start of each epoch, the run of collisions sharing a rotation
+// matrix, the matrix is drawn anew by the rotation source; the matrix
+// rotates the relative velocity of a pair and halves it, see
+// update_vel in rng_state.h. a source provides
+// snapshot_id            : identifier of the source in snapshots
+// uniform_over_rotations : whether the rotations are distributed
+//                          uniformly, i.e. by the Haar measure
+// draw(R, uniform)       : draw the matrix R by the callable uniform,
+//                          which returns uniform variates in [0,1)
+
+// original source: rotation by an angle alpha about an axis at polar
+// angle theta and azimuth phi, each drawn uniformly; theta being drawn
+// uniformly rather than its cosine, the axes cluster at the poles, and
+// the rotations are not uniform, which the collisions do not require
+class euler_rotation
+{
+public:
+  static constexpr std::uint32_t snapshot_id = 0;
+  static constexpr bool uniform_over_rotations = false;
+
+  template <typename Real, typename Uniform>
+  static void
+  draw(basic_rotation_matrix<Real>& R, Uniform uniform)
+  {
+    const double alpha    = 2. * M_PI * uniform();
+    const double theta    = 1. * M_PI * uniform();
+    const double phi      = 2. * M_PI * uniform();
+    const double nx       = std::sin(theta) * std::cos(phi);
+    const double ny       = std::sin(theta) * std::sin(phi);
+    const double nz       = std::cos(theta);
+    const double defl_cos = std::cos(alpha);
+    const double defl_sin = std::sin(alpha);
+    R.xx                  = 0.5 * (nx * nx * (1. - defl_cos) + 1. * defl_cos);
+    R.xy                  = 0.5 * (nx * ny * (1. - defl_cos) - nz * defl_sin);
+    R.xz                  = 0.5 * (nx * nz * (1. - defl_cos) + ny * defl_sin);
+    R.yx                  = 0.5 * (ny * nx * (1. - defl_cos) + nz * defl_sin);
+    R.yy                  = 0.5 * (ny * ny * (1. - defl_cos) + 1. * defl_cos);
+    R.yz                  = 0.5 * (ny * nz * (1. - defl_cos) - nx * defl_sin);
+    R.zx                  = 0.5 * (nz * nx * (1. - defl_cos) - ny * defl_sin);
+    R.zy                  = 0.5 * (nz * ny * (1. - defl_cos) + nx * defl_sin);
+    R.zz                  = 0.5 * (nz * nz * (1. - defl_cos) + 1. * defl_cos);
+    return;
+  }
+};
+
+// trig-free source: rotation by a unit quaternion (w, x, y, z) drawn
+// uniformly from the unit 3-sphere by Marsaglia's method, which takes
+// two points (w, x) and (u, v) uniformly from the unit disk by rejection
+// and scales the second onto the sphere with a single square root;
+// uniform quaternions give uniform rotations. a draw takes 16 / pi,
+// about 5.1, uniform variates on average, and no transcendentals
+class quaternion_rotation
+{
+public:
+  static constexpr std::uint32_t snapshot_id = 1;
+  static constexpr bool uniform_over_rotations = true;
+
+  template <typename Real, typename Uniform>
+  static void
+  draw(basic_rotation_matrix<Real>& R, Uniform uniform)
+  {
+    double w, x, s1;
+    do {
+      w  = 2. * uniform() - 1.;
+      x  = 2. * uniform() - 1.;
+      s1 = w * w + x * x;
+    } while (s1 >= 1.);
+    double u, v, s2;
+    do {
+      u  = 2. * uniform() - 1.;
+      v  = 2. * uniform() - 1.;
+      s2 = u * u + v * v;
+    } while (s2 >= 1. or s2 == 0.);
+    const double scale = std::sqrt((1. - s1) / s2);
+    const double y     = scale * u;
+    const double z     = scale * v;
+    R.xx               = 0.5 - (y * y + z * z);
+    R.xy               = x * y - w * z;
+    R.xz               = x * z + w * y;
+    R.yx               = x * y + w * z;
+    R.yy               = 0.5 - (x * x + z * z);
+    R.yz               = y * z - w * x;
+    R.zx               = x * z - w * y;
+    R.zy               = y * z + w * x;
+    R.zz               = 0.5 - (x * x + y * y);
+    return;
+  }
+};
+
+} // namespace md
@@ -0,0 +1,340 @@
+// Copyright (c) 2018 Santosh Ansumali @ JNCASR
+// See LICENSE
+
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <algorithm>
+#include <array>
+#include <iterator>
+#include <stdexcept>
+#include <utility>
+#include <vector>
+
+namespace md {
+
+// integer sampling kernels
+// ------------------------
+// bounded integers, permutations, reservoir samples and weighted picks
+// built on the 64-bit integers of a generator, see basic_rng::fill_u64;
+// the integers are drawn in blocks, and each kernel advances the
+// generator by exactly the integers it uses, so that the results equal
+// those obtained from successive calls of operator(); bounds up to 2^32
+// use each integer as two 32-bit halves, the high half first
+
+// random 64-bit integers drawn in blocks from a generator Rng providing
+// fill_u64; count is the number of integers expected to be used, which
+// limits the size of the blocks so that no integer is drawn in vain
+template <typename Rng>
+class u64_block
+{
+public:
+  u64_block(Rng& r, const std::size_t count)
+  : m_rng(r),
+    m_count(count)
+  {}
+
+  // next integer, skipping the low half of an integer of which
+  // only the high half has been used
+  std::uint64_t
+  next()
+  {
+    m_pos += m_pos & 1;
+    if (m_pos == 2 * m_size) {
+      refill();
+    }
+    const std::uint64_t x = m_bits[m_pos / 2];
+    m_pos += 2;
+    return x;
+  }
+
+  // next half of an integer, the high half being used first
+  std::uint32_t
+  next_half()
+  {
+    if (m_pos == 2 * m_size) {
+      refill();
+    }
+    const std::uint64_t x = m_bits[m_pos / 2] >> (32 * (~m_pos & 1));
+    m_pos++;
+    return static_cast<std::uint32_t>(x);
+  }
+
+private:
+  static const std::size_t block_size = 256;
+
+  void
+  refill()
+  {
+    m_size  = std::max<std::size_t>(1, std::min(m_count, block_size));
+    m_count = m_count - std::min(m_count, m_size);
+    m_pos   = 0;
+    m_rng.fill_u64(m_bits.data(), m_size);
+    return;
+  }
+
+  Rng&                                    m_rng;
+  std::size_t                             m_count;
+  std::size_t                             m_size = 0;
+  std::size_t                             m_pos  = 0;
+  std::array<std::uint64_t, block_size>   m_bits;
+};
+
+// full 128-bit product of two 64-bit integers, returning the high
+// half and storing the low half in lo
+inline std::uint64_t
+mul_u64(const std::uint64_t a, const std::uint64_t b, std::uint64_t& lo)
+{
+#if defined(__SIZEOF_INT128__)
+  __extension__ typedef unsigned __int128 u128;
+  const u128 p = static_cast<u128>(a) * b;
+  lo = static_cast<std::uint64_t>(p);
+  return static_cast<std::uint64_t>(p >> 64);
+#else
+  const std::uint64_t a_lo = a & 0xffffffff, a_hi = a >> 32;
+  const std::uint64_t b_lo = b & 0xffffffff, b_hi = b >> 32;
+  const std::uint64_t ll   = a_lo * b_lo;
+  const std::uint64_t lh   = a_lo * b_hi;
+  const std::uint64_t hl   = a_hi * b_lo;
+  const std::uint64_t mid  = (ll >> 32) + (lh & 0xffffffff) + (hl & 0xffffffff);
+  lo = (mid << 32) | (ll & 0xffffffff);
+  return a_hi * b_hi + (lh >> 32) + (hl >> 32) + (mid >> 32);
+#endif
+}
+
+// random integer uniformly distributed in [0,bound), bound > 0, by the
+// multiply-shift method of Lemire: the high half of the product of a
+// random integer and bound is the result, and the rare products whose
+// low half falls below 2^64 mod bound are rejected to remove the bias;
+// the low half of the accepted product is stored in lo
+template <typename Rng>
+inline std::uint64_t
+bounded_u64(u64_block<Rng>& bits, const std::uint64_t bound, std::uint64_t& lo)
+{
+  std::uint64_t hi = mul_u64(bits.next(), bound, lo);
+  if (lo < bound) {
+    const std::uint64_t threshold = (0 - bound) % bound;
+    while (lo < threshold) {
+      hi = mul_u64(bits.next(), bound, lo);
+    }
+  }
+  return hi;
+}
+
+template <typename Rng>
+inline std::uint64_t
+bounded_u64(u64_block<Rng>& bits, const std::uint64_t bound)
+{
+  std::uint64_t lo;
+  return bounded_u64(bits, bound, lo);
+}
+
+// as above for 0 < bound <= 2^32, using 32-bit halves of the integers
+template <typename Rng>
+inline std::uint32_t
+bounded_u32(u64_block<Rng>& bits, const std::uint64_t bound)
+{
+  std::uint64_t p = static_cast<std::uint64_t>(bits.next_half()) * bound;
+  if (static_cast<std::uint32_t>(p) < bound) {
+    const std::uint64_t threshold = ((std::uint64_t(1) << 32) - bound) % bound;
+    while (static_cast<std::uint32_t>(p) < threshold) {
+      p = static_cast<std::uint64_t>(bits.next_half()) * bound;
+    }
+  }
+  return static_cast<std::uint32_t>(p >> 32);
+}
+
+// random integer uniformly distributed in [0,bound), using the 32-bit
+// kernel whenever the bound permits
+template <typename Rng>
+inline std::uint64_t
+bounded(u64_block<Rng>& bits, const std::uint64_t bound)
+{
+  if (bound <= (std::uint64_t(1) << 32)) {
+    return bounded_u32(bits, bound);
+  }
+  return bounded_u64(bits, bound);
+}
+
+// writes n random integers uniformly distributed in [0,bound) to out
+template <typename Rng>
+void
+fill_bounded(Rng&              r,
+             std::uint64_t*    out,
+             const std::size_t n,
+             const std::uint64_t bound)
+{
+  if (bound == 0) {
+    throw std::invalid_argument("use a non-zero bound");
+  }
+  if (bound <= (std::uint64_t(1) << 32)) {
+    u64_block<Rng> bits(r, (n + 1) / 2);
+    for (std::size_t i = 0; i < n; i++) {
+      out[i] = bounded_u32(bits, bound);
+    }
+  } else {
+    u64_block<Rng> bits(r, n);
+    for (std::size_t i = 0; i < n; i++) {
+      out[i] = bounded_u64(bits, bound);
+    }
+  }
+  return;
+}
+
+// permutes [first,last) in place, every permutation being equally
+// likely, by the Fisher-Yates shuffle
+template <typename Rng, typename RandomIt>
+void
+shuffle(Rng& r, RandomIt first, RandomIt last)
+{
+  const std::size_t n = std::distance(first, last);
+  if (n < 2) {
+    return;
+  }
+  u64_block<Rng> bits(r, n / 2);
+  for (std::size_t i = n - 1; i > 0; i--) {
+    const std::size_t j = bounded(bits, i + 1);
+    std::iter_swap(first + i, first + j);
+  }
+  return;
+}
+
+// copies a uniformly random subset of k elements of [first,last), or all
+// elements if there are fewer, to the range starting at out by reservoir
+// sampling (algorithm R); returns the number of elements copied
+template <typename Rng, typename ForwardIt, typename RandomIt>
+std::size_t
+sample_reservoir(Rng&              r,
+                 ForwardIt         first,
+                 ForwardIt         last,
+                 RandomIt          out,
+                 const std::size_t k)
+{
+  std::size_t i = 0;
+  for (; i < k and first != last; ++i, ++first) {
+    out[i] = *first;
+  }
+  if (first == last) {
+    return i;
+  }
+  u64_block<Rng> bits(r, (std::distance(first, last) + 1) / 2);
+  for (; first != last; ++i, ++first) {
+    const std::size_t j = bounded(bits, i + 1);
+    if (j < k) {
+      out[j] = *first;
+    }
+  }
+  return k;
+}
+
+// alias table for sampling indices 0..n-1 with probabilities
+// proportional to given non-negative weights in constant time,
+// built by the method of Vose
+class alias_table
+{
+public:
+  template <typename InputIt>
+  alias_table(InputIt first, InputIt last)
+  {
+    const std::vector<double> weights(first, last);
+    const std::size_t n = weights.size();
+    double sum = 0;
+    for (std::size_t i = 0; i < n; i++) {
+      if (not (weights[i] >= 0)) {
+        throw std::invalid_argument("use non-negative weights");
+      }
+      sum += weights[i];
+    }
+    if (n == 0 or not (sum > 0)) {
+      throw std::invalid_argument("use weights with a positive sum");
+    }
+
+    // split the indices into those with a scaled probability below and
+    // above one, then fill each small column up from a large one
+    std::vector<double>      prob(n);
+    std::vector<std::size_t> small;
+    std::vector<std::size_t> large;
+    for (std::size_t i = 0; i < n; i++) {
+      prob[i] = weights[i] * n / sum;
+      (prob[i] < 1. ? small : large).push_back(i);
+    }
+    m_columns.resize(n);
+    while (not small.empty() and not large.empty()) {
+      const std::size_t s = small.back();
+      const std::size_t l = large.back();
+      small.pop_back();
+      large.pop_back();
+      m_columns[s].threshold = to_threshold(prob[s]);
+      m_columns[s].alias     = l;
+      prob[l] = (prob[l] + prob[s]) - 1.;
+      (prob[l] < 1. ? small : large).push_back(l);
+    }
+    // the remaining columns are full up to rounding errors
+    for (std::size_t i = 0; i < large.size(); i++) {
+      m_columns[large[i]].threshold = ~std::uint64_t(0);
+      m_columns[large[i]].alias     = large[i];
+    }
+    for (std::size_t i = 0; i < small.size(); i++) {
+      m_columns[small[i]].threshold = ~std::uint64_t(0);
+      m_columns[small[i]].alias     = small[i];
+    }
+  }
+
+  std::size_t
+  size() const
+  { return m_columns.size(); }
+
+  // generates a random index; a single random integer selects both the
+  // column, by the high half of its product with the number of columns,
+  // and the column or its alias, by the low half, whose resolution
+  // limits the error of the probabilities to size() * 2^-64
+  template <typename Rng>
+  std::size_t
+  sample(Rng& r) const
+  {
+    u64_block<Rng> bits(r, 1);
+    return sample(bits);
+  }
+
+  // writes n random indices to out
+  template <typename Rng>
+  void
+  fill(Rng& r, std::size_t* out, const std::size_t n) const
+  {
+    u64_block<Rng> bits(r, n);
+    for (std::size_t i = 0; i < n; i++) {
+      out[i] = sample(bits);
+    }
+    return;
+  }
+
+private:
+  struct column
+  {
+    std::uint64_t threshold;
+    std::uint64_t alias;
+  };
+
+  static std::uint64_t
+  to_threshold(const double p)
+  {
+    if (p <= 0) {
+      return 0;
+    }
+    return p < 1 ? static_cast<std::uint64_t>(p * 18446744073709551616.) : ~std::uint64_t(0);
+  }
+
+  template <typename Rng>
+  std::size_t
+  sample(u64_block<Rng>& bits) const
+  {
+    std::uint64_t lo;
+    const std::size_t i = bounded_u64(bits, m_columns.size(), lo);
+    return lo < m_columns[i].threshold ? i : m_columns[i].alias;
+  }
+
+  std::vector<column> m_columns;
+};
+
+} // namespace md
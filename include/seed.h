@@ -0,0 +1,23 @@
+// Copyright (c) 2018 Santosh Ansumali @ JNCASR
+// See LICENSE
+
+#pragma once
+
+#include <cstdint>
+
+namespace md {
+
+// derive the seed of the generator with the given index from a base
+// seed, by passing their combination through the splitmix64 finalizer
+// so that generators with consecutive indices get unrelated seeds
+inline unsigned long
+derive_seed(const unsigned long base, const std::uint64_t index)
+{
+  std::uint64_t z = static_cast<std::uint64_t>(base)
+                  + (index + 1) * UINT64_C(0x9e3779b97f4a7c15);
+  z = (z ^ (z >> 30)) * UINT64_C(0xbf58476d1ce4e5b9);
+  z = (z ^ (z >> 27)) * UINT64_C(0x94d049bb133111eb);
+  return static_cast<unsigned long>(z ^ (z >> 31));
+}
+
+} // namespace md
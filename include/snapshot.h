@@ -0,0 +1,213 @@
+// Copyright (c) 2018 Santosh Ansumali @ JNCASR
+// See LICENSE
+
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <cstring>
+#include <istream>
+#include <limits>
+#include <stdexcept>
+#include <string>
+
+// snapshot files are memory-mapped on POSIX systems, and read as
+// streams elsewhere
+#if defined(__unix__) || defined(__APPLE__)
+#define MD_RNG_MMAP 1
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#else
+#define MD_RNG_MMAP 0
+#endif
+
+namespace md {
+
+// binary snapshot of the complete state of a generator
+// ----------------------------------------------------
+// a snapshot consists of the header below followed by one record per
+// particle holding x, y, z, vx, vy, vz in the real type of the
+// generator; the size of that type and the native byte order, in which
+// all values are stored, are recorded in the header and checked when
+// the snapshot is loaded. the header size is a multiple of 64 bytes,
+// so that the particle records of a memory-mapped snapshot are aligned.
+// the buffers of the scalar calls of a generator with a buffer depth
+// above 1 don't fit in the header, and follow the particle records as
+// the uniform, normal and exponential buffers in turn
+
+// version of the snapshot format, to be incremented whenever the
+// header or the particle records change
+const std::uint32_t snapshot_version = 2;
+
+struct alignas(64) snapshot_header
+{
+  char          magic[8];
+  std::uint32_t version;
+  std::uint32_t byte_order;
+  std::uint32_t real_size;
+  std::uint32_t dim;
+  std::uint64_t num_particles;
+
+  // parameters of the generator
+  double        dt;
+  std::uint64_t max_unip_buffers_filled;
+  std::uint64_t max_pairs_collided;
+
+  // progress of the generator
+  std::uint64_t num_unips_used;
+  std::uint64_t num_norms_used;
+  std::uint64_t num_unifs_used;
+  std::uint64_t num_expos_used;
+  std::uint64_t num_unip_buffers_filled;
+  std::uint64_t num_pairs_collided;
+  std::uint64_t start;
+  std::uint64_t shift;
+  std::uint64_t jump;
+  std::uint64_t idx_a;
+  std::uint64_t idx_b;
+  std::uint64_t batch_disjoint;
+  double        rot_matrix[9];
+
+  // contents of the buffers
+  double        unip_buffer[6];
+  double        norm_buffer[3];
+  double        unif_buffer[6];
+  double        expo_buffer[3];
+
+  // origin, size and epoch of the tiles of the tiled pair selection
+  // scheme, see pair_selection.h, all zero for the global scheme; they
+  // occupy the padding of the header before their introduction, so that
+  // the snapshots of the global scheme are unchanged
+  std::uint64_t tile_origin;
+  std::uint32_t tile_size;
+  std::uint32_t tile_epoch;
+
+  // collisions per refill of the buffers of the scalar calls; the
+  // buffers above are unused unless it is 1
+  std::uint64_t buffer_depth;
+
+  // source of the rotation matrices, see rotation_source.h, 0 for the
+  // original source, in the padding of the header like the tiles
+  std::uint32_t rotation_source;
+
+  // bits of the fixed-point coordinates of the particle system, see
+  // fixed_point_rng.h, 0 for real coordinates
+  std::uint32_t fixed_point_bits;
+};
+
+// number of values in each particle record
+const std::size_t snapshot_record_size = 6;
+
+inline void
+init_snapshot_header(snapshot_header& h, const std::size_t real_size)
+{
+  std::memset(&h, 0, sizeof(h));
+  std::memcpy(h.magic, "MDRNGSNP", 8);
+  h.version    = snapshot_version;
+  h.byte_order = 0x01020304;
+  h.real_size  = real_size;
+  return;
+}
+
+// throws if the header doesn't describe a snapshot which can be
+// loaded by this build
+inline void
+check_snapshot_header(const snapshot_header& h,
+                      const std::size_t      dim,
+                      const std::size_t      real_size)
+{
+  if (std::memcmp(h.magic, "MDRNGSNP", 8) != 0) {
+    throw std::runtime_error("not a molecular dice RNG snapshot");
+  }
+  if (h.version != snapshot_version) {
+    throw std::runtime_error("unsupported RNG snapshot version");
+  }
+  if (h.byte_order != 0x01020304 or h.dim != dim) {
+    throw std::runtime_error("RNG snapshot written on an incompatible platform");
+  }
+  if (h.real_size != real_size) {
+    throw std::runtime_error("RNG snapshot of a generator with another real type");
+  }
+  return;
+}
+
+// largest particle count accepted from a snapshot; the particle system
+// is allocated before its records are read, which are also checked to
+// be present if the length of the snapshot can be told
+constexpr std::uint64_t max_snapshot_particles = std::uint64_t(1) << 32;
+
+// bytes left to read from a stream, or the largest count if the stream
+// cannot seek, e.g. a pipe
+inline std::uint64_t
+snapshot_bytes_left(std::istream& in)
+{
+  const std::istream::pos_type here = in.tellg();
+  if (here == std::istream::pos_type(-1)) {
+    in.clear();
+    return std::numeric_limits<std::uint64_t>::max();
+  }
+  in.seekg(0, std::ios::end);
+  const std::istream::pos_type end = in.tellg();
+  in.clear();
+  in.seekg(here);
+  if (end == std::istream::pos_type(-1) or end < here) {
+    return std::numeric_limits<std::uint64_t>::max();
+  }
+  return static_cast<std::uint64_t>(end - here);
+}
+
+#if MD_RNG_MMAP
+
+// read-only memory mapping of a whole file
+class mapped_file
+{
+public:
+  explicit mapped_file(const std::string& path)
+  {
+    const int fd = ::open(path.c_str(), O_RDONLY);
+    if (fd < 0) {
+      throw std::runtime_error("cannot open " + path);
+    }
+    struct stat st;
+    if (::fstat(fd, &st) != 0) {
+      ::close(fd);
+      throw std::runtime_error("cannot stat " + path);
+    }
+    m_size = static_cast<std::size_t>(st.st_size);
+    if (m_size > 0) {
+      m_data = ::mmap(nullptr, m_size, PROT_READ, MAP_PRIVATE, fd, 0);
+    }
+    ::close(fd);
+    if (m_data == MAP_FAILED) {
+      throw std::runtime_error("cannot map " + path);
+    }
+  }
+
+  mapped_file(const mapped_file&) = delete;
+  mapped_file& operator=(const mapped_file&) = delete;
+
+  ~mapped_file()
+  {
+    if (m_data != nullptr and m_data != MAP_FAILED) {
+      ::munmap(m_data, m_size);
+    }
+  }
+
+  const char*
+  data() const
+  { return static_cast<const char*>(m_data); }
+
+  std::size_t
+  size() const
+  { return m_size; }
+
+private:
+  void*       m_data = nullptr;
+  std::size_t m_size = 0;
+};
+
+#endif
+
+} // namespace md
@@ -0,0 +1,83 @@
+// Copyright (c) 2018 Santosh Ansumali @ JNCASR
+// See LICENSE
+
+#pragma once
+
+#include <cstddef>
+#include <ratio>
+#include <stdexcept>
+#include "particle_layout.h"
+#include "rng_state.h"
+#include "rng.h"
+
+namespace md {
+
+// time gap between successive collisions fixed at compile time as the
+// std::ratio Dt, so that it is a constant in every position update
+template <typename Dt>
+class static_time_step
+{
+public:
+  static constexpr double value = static_cast<double>(Dt::num) / Dt::den;
+
+  constexpr static_time_step()
+  {}
+
+  // conversion from a time gap given at runtime, e.g. by the generator
+  // constructors or a snapshot, which must be equal to the fixed one
+  static_time_step(const double dt)
+  {
+    if (dt != value) {
+      throw std::invalid_argument("time gap differs from the fixed time gap");
+    }
+  }
+
+  constexpr operator double() const
+  { return value; }
+};
+
+// particle system of N particles, N being a power of two not less than
+// 16, and time gap Dt fixed at compile time; the particles are stored
+// within the object itself, see fixed_aos_storage, and particle indices
+// are wrapped by a mask
+template <std::size_t N, typename Dt = std::ratio<1, 10>, typename Real = double>
+class static_rng_state : public basic_rng_state<fixed_aos_layout<N>, Real>
+{
+  static_assert(N >= 16 and (N & (N - 1)) == 0,
+                "number of particles must be a power of two not less than 16");
+
+  typedef basic_rng_state<fixed_aos_layout<N>, Real> base_type;
+
+public:
+  typedef static_time_step<Dt> time_step_type;
+
+  // default number of particles and time gap of a generator
+  static constexpr std::size_t default_num_particles = N;
+  static constexpr double      default_time_step     = time_step_type::value;
+
+  // constructor
+  static_rng_state()
+  : base_type(N)
+  {}
+
+  static_rng_state(const std::size_t num)
+  : base_type(num)
+  {}
+
+  static constexpr std::size_t
+  num_particles()
+  { return N; }
+
+  // wrap a particle index lying within [0,2 N) to [0,N)
+  std::size_t
+  wrap_index(const std::size_t idx) const
+  { return idx & (N - 1); }
+};
+
+// molecular dice RNG with a particle system of compile-time size N and
+// time gap Dt; it generates the same random numbers as an md::rng
+// constructed with the same seed, N particles and time gap Dt
+template <std::size_t N, typename Dt = std::ratio<1, 10>>
+using static_rng = basic_rng<static_rng_state<N, Dt>>;
+
+} // namespace md
@@ -6,11 +6,12 @@
 namespace md {
 
 // velocity components of a particle
-class velocity
+template <typename Real>
+class basic_velocity
 {
 public:
-  velocity&
-  operator+=(const velocity& rhs)
+  basic_velocity&
+  operator+=(const basic_velocity& rhs)
   {
     this->vx += rhs.vx;
     this->vy += rhs.vy;
@@ -18,8 +19,8 @@ public:
     return *this;
   }
 
-  velocity&
-  operator-=(const velocity& rhs)
+  basic_velocity&
+  operator-=(const basic_velocity& rhs)
   {
     this->vx -= rhs.vx;
     this->vy -= rhs.vy;
@@ -27,8 +28,8 @@ public:
     return *this;
   }
 
-  velocity&
-  operator*=(const double rhs)
+  basic_velocity&
+  operator*=(const Real rhs)
   {
     this->vx *= rhs;
     this->vy *= rhs;
@@ -36,8 +37,8 @@ public:
     return *this;
   }
 
-  velocity&
-  operator/=(const double rhs)
+  basic_velocity&
+  operator/=(const Real rhs)
   {
     this->vx /= rhs;
     this->vy /= rhs;
@@ -45,61 +46,128 @@ public:
     return *this;
   }
 
-  double vx;
-  double vy;
-  double vz;
+  // arithmetic operators are defined as friends so that scalars of
+  // other arithmetic types are converted to Real
+
+  friend basic_velocity
+  operator+(const basic_velocity& a, const basic_velocity& b)
+  {
+    basic_velocity c;
+    c.vx = a.vx + b.vx;
+    c.vy = a.vy + b.vy;
+    c.vz = a.vz + b.vz;
+    return c;
+  }
+
+  friend basic_velocity
+  operator-(const basic_velocity& a, const basic_velocity& b)
+  {
+    basic_velocity c;
+    c.vx = a.vx - b.vx;
+    c.vy = a.vy - b.vy;
+    c.vz = a.vz - b.vz;
+    return c;
+  }
+
+  friend Real
+  operator*(const basic_velocity& a, const basic_velocity& b)
+  {
+    return a.vx * b.vx + a.vy * b.vy + a.vz * b.vz;
+  }
+
+  friend basic_velocity
+  operator*(const basic_velocity& a, const Real b)
+  {
+    basic_velocity c;
+    c.vx = a.vx * b;
+    c.vy = a.vy * b;
+    c.vz = a.vz * b;
+    return c;
+  }
+
+  friend basic_velocity
+  operator*(const Real b, const basic_velocity& a)
+  {
+    return a * b;
+  }
+
+  friend basic_velocity
+  operator/(const basic_velocity& a, const Real b)
+  {
+    basic_velocity c;
+    c.vx = a.vx / b;
+    c.vy = a.vy / b;
+    c.vz = a.vz / b;
+    return c;
+  }
+
+  Real vx;
+  Real vy;
+  Real vz;
 };
 
-velocity
-operator+(const velocity& a, const velocity& b)
-{
-  velocity c;
-  c.vx = a.vx + b.vx;
-  c.vy = a.vy + b.vy;
-  c.vz = a.vz + b.vz;
-  return c;
-}
-
-velocity
-operator-(const velocity& a, const velocity& b)
-{
-  velocity c;
-  c.vx = a.vx - b.vx;
-  c.vy = a.vy - b.vy;
-  c.vz = a.vz - b.vz;
-  return c;
-}
-
-double
-operator*(const velocity& a, const velocity& b)
-{
-  return a.vx * b.vx + a.vy * b.vy + a.vz * b.vz;
-}
+typedef basic_velocity<double> velocity;
 
-velocity
-operator*(const velocity& a, const double b)
-{
-  velocity c;
-  c.vx = a.vx * b;
-  c.vy = a.vy * b;
-  c.vz = a.vz * b;
-  return c;
-}
-
-velocity
-operator*(const double b, const velocity& a)
+// reference to velocity components of a particle, for storage
+// layouts which do not hold the components in a velocity record
+template <typename Real>
+class basic_velocity_ref
 {
-  return a * b;
-}
+public:
+  basic_velocity_ref&
+  operator=(const basic_velocity<Real>& rhs)
+  {
+    this->vx = rhs.vx;
+    this->vy = rhs.vy;
+    this->vz = rhs.vz;
+    return *this;
+  }
 
-velocity
-operator/(const velocity& a, const double b)
-{
-  velocity c;
-  c.vx = a.vx / b;
-  c.vy = a.vy / b;
-  c.vz = a.vz / b;
-  return c;
-}
+  basic_velocity_ref&
+  operator=(const basic_velocity_ref& rhs)
+  { return *this = static_cast<basic_velocity<Real>>(rhs); }
+
+  basic_velocity_ref&
+  operator+=(const basic_velocity<Real>& rhs)
+  {
+    this->vx += rhs.vx;
+    this->vy += rhs.vy;
+    this->vz += rhs.vz;
+    return *this;
+  }
+
+  basic_velocity_ref&
+  operator-=(const basic_velocity<Real>& rhs)
+  {
+    this->vx -= rhs.vx;
+    this->vy -= rhs.vy;
+    this->vz -= rhs.vz;
+    return *this;
+  }
+
+  basic_velocity_ref&
+  operator*=(const Real rhs)
+  {
+    this->vx *= rhs;
+    this->vy *= rhs;
+    this->vz *= rhs;
+    return *this;
+  }
+
+  operator basic_velocity<Real>() const
+  {
+    basic_velocity<Real> v;
+    v.vx = this->vx;
+    v.vy = this->vy;
+    v.vz = this->vz;
+    return v;
+  }
+
+  Real& vx;
+  Real& vy;
+  Real& vz;
+};
+
+typedef basic_velocity_ref<double> velocity_ref;
 
 } // namespace md
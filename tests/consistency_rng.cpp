@@ -0,0 +1,121 @@
+#include <iostream>
+#include <string>
+#include <vector>
+#include <utility>
+#include <algorithm>
+#include <cstddef>
+#include <cstdint>
+#include <cstring>
+#include <md_rng.h>
+
+// bulk and scalar consistency check
+// ---------------------------------
+// the bulk calls have to continue the sequence of the scalar calls bit
+// for bit, at every buffer depth and for the instruction set the kernels
+// run with, see MD_RNG_ISA; the sequence of a generator must not depend
+// on its buffer depth either. each case draws n variates from one
+// generator by scalar calls, and from another by the bulk call, after
+// the same number of scalar calls, which leave a partly used buffer
+
+const std::size_t num_variates = 100003;
+const std::size_t depths[]     = {1, 2, 7, 64};
+
+std::size_t num_failed = 0;
+
+template <typename T>
+void
+expect_equal(const std::vector<T>& a, const std::vector<T>& b, const std::string& name)
+{
+  if (std::memcmp(a.data(), b.data(), a.size() * sizeof(T)) != 0) {
+    std::cout << "FAIL " << name << "\n";
+    num_failed++;
+  }
+  return;
+}
+
+template <typename Rng, typename Scalar, typename Bulk>
+void
+check_dist(const std::string& name, std::size_t depth, std::size_t skip,
+           Scalar scalar, Bulk bulk)
+{
+  typedef decltype(scalar(std::declval<Rng&>())) value_type;
+  Rng a(1234, 4096);
+  Rng b(1234, 4096);
+  a.set_buffer_depth(depth);
+  b.set_buffer_depth(depth);
+  std::vector<value_type> x(num_variates);
+  std::vector<value_type> y(num_variates);
+  for (std::size_t i = 0; i < skip; i++) {
+    scalar(b);
+  }
+  for (std::size_t i = 0; i < num_variates; i++) {
+    x[i] = scalar(a);
+  }
+  bulk(b, y.data() + skip, num_variates - skip);
+  std::copy(x.begin(), x.begin() + skip, y.begin());
+  expect_equal(x, y, name + " depth " + std::to_string(depth) + " skip " + std::to_string(skip));
+
+  // the same sequence at the deepest buffer
+  Rng c(1234, 4096);
+  c.set_buffer_depth(depths[3]);
+  for (std::size_t i = 0; i < num_variates; i++) {
+    y[i] = scalar(c);
+  }
+  expect_equal(x, y, name + " depth " + std::to_string(depth) + " against depth 64");
+  return;
+}
+
+template <typename Rng>
+void
+check_generator(const std::string& name)
+{
+  typedef typename Rng::real_type   real_type;
+  typedef typename Rng::result_type result_type;
+  for (std::size_t depth : depths) {
+    for (std::size_t skip : {std::size_t(0), std::size_t(5)}) {
+      check_dist<Rng>(name + " uniform", depth, skip,
+        [](Rng& r) { return r.uniform(); },
+        [](Rng& r, real_type* out, std::size_t n) { r.fill_uniform(out, n); });
+      check_dist<Rng>(name + " normal", depth, skip,
+        [](Rng& r) { return r.normal(); },
+        [](Rng& r, real_type* out, std::size_t n) { r.fill_normal(out, n); });
+      check_dist<Rng>(name + " exponential", depth, skip,
+        [](Rng& r) { return r.exp(); },
+        [](Rng& r, real_type* out, std::size_t n) { r.fill_exp(out, n); });
+      check_dist<Rng>(name + " uint64", depth, skip,
+        [](Rng& r) { return r(); },
+        [](Rng& r, result_type* out, std::size_t n) { r.fill_u64(out, n); });
+    }
+  }
+  return;
+}
+
+// a program compiled for an instruction set the processor lacks is
+// skipped, as reported by the exit status 77
+bool
+supported()
+{
+#if defined(__AVX2__) && defined(__GNUC__)
+  __builtin_cpu_init();
+  return __builtin_cpu_supports("avx2") and __builtin_cpu_supports("fma");
+#else
+  return true;
+#endif
+}
+
+int
+main()
+{
+  if (not supported()) {
+    std::cout << "instruction set not supported\n";
+    return 77;
+  }
+  std::cout << "isa " << md::isa_name(md::active_isa()) << "\n";
+  check_generator<md::rng>("molecular_dice");
+  check_generator<md::rng_float>("molecular_dice_float");
+  check_generator<md::rng_tiled>("molecular_dice_tiled");
+  check_generator<md::rng_quaternion>("molecular_dice_quaternion");
+  check_generator<md::rng_fixed64>("molecular_dice_fixed64");
+  std::cout << (num_failed == 0 ? "PASS" : "FAIL") << "\n";
+  return num_failed == 0 ? 0 : 1;
+}
@@ -0,0 +1,783 @@
+#include <iostream>
+#include <iomanip>
+#include <sstream>
+#include <string>
+#include <vector>
+#include <atomic>
+#include <thread>
+#include <chrono>
+#include <exception>
+#include <stdexcept>
+#include <algorithm>
+#include <random>
+#include <cmath>
+#include <cstddef>
+#include <cstdint>
+#include <memory>
+#include <md_rng.h>
+
+// streaming statistical quality gate
+// ----------------------------------
+// streams of variates drawn from generators seeded with derive_seed(seed,
+// s) are checked against their target distributions; the streams are
+// processed in groups of G streams drawn in lockstep, block by block, so
+// that the cross-stream correlations within a group can be accumulated
+// along with the statistics of each stream; all statistics are single
+// pass sums, accumulated per thread and merged by addition at the end
+//
+// the tests, each reported with a p-value and failed if it lies below
+// alpha, are
+// mean, variance, skewness, kurtosis : z-scores of the sums of the first
+//                     four powers of the standardized variates, against
+//                     the moments of the target distribution
+// chi-square        : histogram of the variates against the target
+//                     distribution, in bins of about equal probability
+// kolmogorov-smirnov: largest deviation of the empirical distribution
+//                     function from the target one, at the bin edges of
+//                     a fine histogram
+// autocorrelation   : serial correlations of each stream at the given
+//                     lags, as the largest z-score over all lags and as
+//                     the sum of the squared z-scores
+// cross-stream      : correlations of the variates at the same position
+//                     in the streams of each pair within a group, in the
+//                     same two forms
+// rotation          : uniformity over rotations of the rotation matrices
+//                     of a rotation source which claims it, as the
+//                     kolmogorov-smirnov tests of the rotation angle and
+//                     of the cosine and azimuth of the image of the z axis
+
+// target distributions
+enum class dist {uniform, normal, exp};
+
+const std::vector<std::string> dist_names = {"uniform", "normal", "exponential"};
+
+double
+uniform_cdf(const double x)
+{ return std::min(1., std::max(0., x)); }
+
+double
+normal_cdf(const double x)
+{ return 0.5 * std::erfc(-x / std::sqrt(2.)); }
+
+double
+exp_cdf(const double x)
+{ return x > 0 ? -std::expm1(-x) : 0.; }
+
+// properties of a target distribution: mean and standard deviation, the
+// third, fourth, sixth and eighth standardized central moments, the
+// range of the fine histogram and the distribution function
+struct target
+{
+  double mean;
+  double sigma;
+  double m3;
+  double m4;
+  double m6;
+  double m8;
+  double lo;
+  double hi;
+  double (*cdf)(double);
+};
+
+target
+make_target(const dist d)
+{
+  switch(d)
+  {
+    case dist::uniform :
+      return {0.5, std::sqrt(1. / 12.), 0., 1.8, 1728. / 448., 9., 0., 1., uniform_cdf};
+    case dist::normal :
+      return {0., 1., 0., 3., 15., 105., -8., 8., normal_cdf};
+    case dist::exp :
+    default :
+      return {1., 1., 2., 9., 265., 14833., 0., 32., exp_cdf};
+  }
+}
+
+// number of bins of the fine histogram, which has one more bin on
+// either side for the variates outside its range
+const std::size_t fine_bins = 1 << 16;
+
+// number of bins of about equal probability of the chi-square test
+const std::size_t chi_squared_bins = 1024;
+
+// mergeable single pass statistics of one distribution
+struct accumulator
+{
+  std::size_t                count = 0;
+  double                     pow_sum[4] = {0., 0., 0., 0.};
+  std::vector<std::uint64_t> hist;
+  std::vector<double>        lag_sum;
+  std::vector<double>        lag_count;
+  std::vector<double>        cross_sum;
+  std::vector<double>        cross_count;
+
+  accumulator(const std::size_t num_lags)
+  : hist(fine_bins + 2, 0),
+    lag_sum(num_lags, 0.),
+    lag_count(num_lags, 0.)
+  {}
+
+  void
+  merge(const accumulator& a)
+  {
+    count += a.count;
+    for (std::size_t k = 0; k < 4; k++) {
+      pow_sum[k] += a.pow_sum[k];
+    }
+    for (std::size_t i = 0; i < hist.size(); i++) {
+      hist[i] += a.hist[i];
+    }
+    for (std::size_t l = 0; l < lag_sum.size(); l++) {
+      lag_sum[l]   += a.lag_sum[l];
+      lag_count[l] += a.lag_count[l];
+    }
+    cross_sum.insert(cross_sum.end(), a.cross_sum.begin(), a.cross_sum.end());
+    cross_count.insert(cross_count.end(), a.cross_count.begin(), a.cross_count.end());
+    return;
+  }
+};
+
+// settings of a run
+struct settings
+{
+  std::string              rng       = "molecular_dice";
+  std::string              api       = "bulk";
+  std::string              start     = "equilibriate";
+  std::vector<dist>        dists     = {dist::uniform, dist::normal, dist::exp};
+  std::size_t              samples   = std::size_t(1) << 26;
+  std::size_t              streams   = 8;
+  std::size_t              group     = 4;
+  std::size_t              particles = 131072;
+  std::size_t              rotations = std::size_t(1) << 22;
+  unsigned                 threads   = 0;
+  unsigned long            seed      = 1234;
+  double                   alpha     = 1e-4;
+  std::vector<std::size_t> lags      = {1, 2, 3, 4, 5, 6, 7, 8, 9, 10, 11, 12,
+                                        16, 24, 32, 48, 64, 128, 256, 512, 1024,
+                                        2048, 4096, 8192, 16384};
+};
+
+// variates per block of a stream
+const std::size_t block_size = 8192;
+
+// draws the variates of a group of streams block by block and
+// accumulates their statistics
+template <typename Rng>
+class group_checker
+{
+public:
+  typedef typename Rng::real_type real_type;
+
+  group_checker(const settings& s, const dist d, const target& t)
+  : m_settings(s),
+    m_dist(d),
+    m_target(t),
+    m_max_lag(*std::max_element(s.lags.begin(), s.lags.end())),
+    m_draw(block_size)
+  {}
+
+  void
+  run(const std::size_t first_stream, const std::size_t num_streams, accumulator& acc)
+  {
+    std::vector<Rng> gens;
+    std::vector<std::vector<double>> y(num_streams);
+    std::unique_ptr<Rng> templ;
+    if (m_settings.start == "template") {
+      templ.reset(new Rng(m_settings.seed, m_settings.particles));
+    }
+    for (std::size_t g = 0; g < num_streams; g++) {
+      const unsigned long seed = md::derive_seed(m_settings.seed, first_stream + g);
+      if (m_settings.start == "fast") {
+        gens.emplace_back(md::fast_start, seed, m_settings.particles);
+      } else if (m_settings.start == "template") {
+        gens.emplace_back(*templ, seed);
+      } else {
+        gens.emplace_back(seed, m_settings.particles);
+      }
+      y[g].assign(m_max_lag + block_size, 0.);
+    }
+    const std::size_t num_pairs = num_streams * (num_streams - 1) / 2;
+    std::vector<double> cross(num_pairs, 0.);
+
+    for (std::size_t pos = 0; pos < m_settings.samples; pos += block_size) {
+      const std::size_t n = std::min(block_size, m_settings.samples - pos);
+      for (std::size_t g = 0; g < num_streams; g++) {
+        draw(gens[g], n);
+        double* yb = y[g].data() + m_max_lag;
+        for (std::size_t i = 0; i < n; i++) {
+          yb[i] = (m_draw[i] - m_target.mean) / m_target.sigma;
+        }
+        accumulate_stream(y[g].data(), n, pos, acc);
+      }
+      std::size_t p = 0;
+      for (std::size_t g = 0; g < num_streams; g++) {
+        for (std::size_t h = g + 1; h < num_streams; h++, p++) {
+          cross[p] += dot(y[g].data() + m_max_lag, y[h].data() + m_max_lag, n);
+        }
+      }
+      // keep the last max_lag variates of each stream as history
+      for (std::size_t g = 0; g < num_streams; g++) {
+        std::copy(y[g].begin() + n, y[g].begin() + n + m_max_lag, y[g].begin());
+      }
+    }
+    for (std::size_t p = 0; p < num_pairs; p++) {
+      acc.cross_sum.push_back(cross[p]);
+      acc.cross_count.push_back(m_settings.samples);
+    }
+    return;
+  }
+
+private:
+  // sum of the products of n pairs of values, in eight partial
+  // sums which the compiler can keep in the lanes of SIMD registers
+  static double
+  dot(const double* a, const double* b, const std::size_t n)
+  {
+    double s[8] = {0., 0., 0., 0., 0., 0., 0., 0.};
+    std::size_t i = 0;
+    for (; i + 8 <= n; i += 8) {
+      for (std::size_t j = 0; j < 8; j++) {
+        s[j] += a[i + j] * b[i + j];
+      }
+    }
+    for (; i < n; i++) {
+      s[0] += a[i] * b[i];
+    }
+    return ((s[0] + s[1]) + (s[2] + s[3])) + ((s[4] + s[5]) + (s[6] + s[7]));
+  }
+
+  void
+  draw(Rng& r, const std::size_t n)
+  {
+    real_type* out = m_draw.data();
+    if (m_settings.api == "scalar") {
+      for (std::size_t i = 0; i < n; i++) {
+        switch(m_dist)
+        {
+          case dist::uniform : out[i] = r.uniform(); break;
+          case dist::normal  : out[i] = r.normal(); break;
+          case dist::exp     : out[i] = r.exp(); break;
+          default            : break;
+        }
+      }
+    } else {
+      switch(m_dist)
+      {
+        case dist::uniform : r.fill_uniform(out, n); break;
+        case dist::normal  : r.fill_normal(out, n); break;
+        case dist::exp     : r.fill_exp(out, n); break;
+        default            : break;
+      }
+    }
+    return;
+  }
+
+  // accumulate the statistics of a block of n standardized variates,
+  // which follow the max_lag variates of history in y; pos is the
+  // position of the block within its stream
+  void
+  accumulate_stream(const double* y, const std::size_t n, const std::size_t pos, accumulator& acc)
+  {
+    const double* yb = y + m_max_lag;
+    const double  inv_width = fine_bins / (m_target.hi - m_target.lo);
+    double s1 = 0, s2 = 0, s3 = 0, s4 = 0;
+    for (std::size_t i = 0; i < n; i++) {
+      const double v  = yb[i];
+      const double v2 = v * v;
+      s1 += v;
+      s2 += v2;
+      s3 += v2 * v;
+      s4 += v2 * v2;
+
+      // variates at the upper end of the range are counted in the last bin
+      const double x = m_target.mean + m_target.sigma * v;
+      std::size_t bin;
+      if (x < m_target.lo) {
+        bin = 0;
+      } else if (x > m_target.hi) {
+        bin = fine_bins + 1;
+      } else {
+        bin = 1 + std::min(fine_bins - 1, static_cast<std::size_t>((x - m_target.lo) * inv_width));
+      }
+      acc.hist[bin]++;
+    }
+    acc.count      += n;
+    acc.pow_sum[0] += s1;
+    acc.pow_sum[1] += s2;
+    acc.pow_sum[2] += s3;
+    acc.pow_sum[3] += s4;
+
+    for (std::size_t l = 0; l < m_settings.lags.size(); l++) {
+      const std::size_t lag = m_settings.lags[l];
+      // the first lag variates of a stream have no partner
+      const std::size_t first = (pos >= lag) ? 0 : std::min(n, lag - pos);
+      acc.lag_sum[l]   += dot(yb + first, yb + first - lag, n - first);
+      acc.lag_count[l] += n - first;
+    }
+    return;
+  }
+
+  const settings&        m_settings;
+  dist                   m_dist;
+  target                 m_target;
+  std::size_t            m_max_lag;
+  std::vector<real_type> m_draw;
+};
+
+// runs all groups of streams of all distributions on the given number
+// of threads, returning the merged statistics of each distribution
+template <typename Rng>
+std::vector<accumulator>
+run_checks(const settings& s)
+{
+  const std::size_t num_groups = (s.streams + s.group - 1) / s.group;
+  const std::size_t num_tasks  = num_groups * s.dists.size();
+  unsigned threads = s.threads ? s.threads : std::thread::hardware_concurrency();
+  threads = std::max(1u, std::min<unsigned>(threads, num_tasks));
+
+  // per thread statistics of each distribution
+  std::vector<std::vector<accumulator>> accs(threads,
+    std::vector<accumulator>(s.dists.size(), accumulator(s.lags.size())));
+
+  std::atomic<std::size_t> next_task(0);
+  std::vector<std::exception_ptr> errors(threads);
+  auto work = [&](const unsigned t) {
+    try {
+      for (std::size_t k = next_task++; k < num_tasks; k = next_task++) {
+        const std::size_t d     = k % s.dists.size();
+        const std::size_t first = (k / s.dists.size()) * s.group;
+        const std::size_t num   = std::min(s.group, s.streams - first);
+        group_checker<Rng> checker(s, s.dists[d], make_target(s.dists[d]));
+        checker.run(first, num, accs[t][d]);
+      }
+    } catch (...) {
+      errors[t] = std::current_exception();
+    }
+  };
+
+  std::vector<std::thread> pool;
+  for (unsigned t = 1; t < threads; t++) {
+    pool.emplace_back(work, t);
+  }
+  work(0);
+  for (std::size_t t = 0; t < pool.size(); t++) {
+    pool[t].join();
+  }
+  for (std::size_t t = 0; t < errors.size(); t++) {
+    if (errors[t]) {
+      std::rethrow_exception(errors[t]);
+    }
+  }
+
+  for (unsigned t = 1; t < threads; t++) {
+    for (std::size_t d = 0; d < s.dists.size(); d++) {
+      accs[0][d].merge(accs[t][d]);
+    }
+  }
+  return accs[0];
+}
+
+// p-values
+// --------
+
+// two-sided p-value of a standard normal z-score
+double
+normal_p(const double z)
+{ return std::erfc(std::abs(z) / std::sqrt(2.)); }
+
+// upper tail p-value of a chi-square statistic with k degrees of
+// freedom, by the Wilson-Hilferty approximation
+double
+chi_squared_p(const double x, const double k)
+{
+  const double v = 2. / (9. * k);
+  const double z = (std::cbrt(x / k) - (1. - v)) / std::sqrt(v);
+  return 0.5 * std::erfc(z / std::sqrt(2.));
+}
+
+// p-value of a Kolmogorov-Smirnov distance d of n samples,
+// by the asymptotic Kolmogorov distribution
+double
+kolmogorov_p(const double d, const double n)
+{
+  const double sn     = std::sqrt(n);
+  const double lambda = (sn + 0.12 + 0.11 / sn) * d;
+  if (lambda < 0.2) {
+    return 1.;
+  }
+  double p = 0;
+  for (int k = 1; k <= 100; k++) {
+    const double term = std::exp(-2. * k * k * lambda * lambda);
+    p += (k % 2 ? 2. : -2.) * term;
+    if (term < 1e-16) {
+      break;
+    }
+  }
+  return std::min(1., std::max(0., p));
+}
+
+// report
+// ------
+
+struct check
+{
+  std::string dist;
+  std::string test;
+  std::string statistic;
+  double      p;
+};
+
+std::string
+format_stat(const std::string& name, const double value)
+{
+  std::ostringstream out;
+  out << name << " = " << std::setprecision(4) << value;
+  return out.str();
+}
+
+// the largest z-score of a family of correlations, Bonferroni-corrected,
+// and the sum of their squared z-scores
+void
+add_correlation_checks(std::vector<check>&             checks,
+                       const std::string&              dist_name,
+                       const std::string&              test,
+                       const std::vector<double>&      z,
+                       const std::vector<std::string>& labels)
+{
+  if (z.empty()) {
+    return;
+  }
+  std::size_t k_max = 0;
+  double chi2 = 0;
+  for (std::size_t k = 0; k < z.size(); k++) {
+    chi2 += z[k] * z[k];
+    if (std::abs(z[k]) > std::abs(z[k_max])) {
+      k_max = k;
+    }
+  }
+  const double p_max = std::min(1., z.size() * normal_p(z[k_max]));
+  checks.push_back({dist_name, test + " max",
+                    format_stat("z", z[k_max]) + " " + labels[k_max], p_max});
+  checks.push_back({dist_name, test + " sum",
+                    format_stat("chi2", chi2) + " df " + std::to_string(z.size()),
+                    chi_squared_p(chi2, z.size())});
+  return;
+}
+
+void
+add_checks(std::vector<check>& checks, const settings& s, const dist d, const accumulator& a)
+{
+  const target      t    = make_target(d);
+  const std::string name = dist_names[int(d)];
+  const double      n    = a.count;
+
+  // moments
+  const double z1 = a.pow_sum[0] / std::sqrt(n);
+  const double z2 = (a.pow_sum[1] - n) / std::sqrt(n * (t.m4 - 1.));
+  const double z3 = (a.pow_sum[2] - n * t.m3) / std::sqrt(n * (t.m6 - t.m3 * t.m3));
+  const double z4 = (a.pow_sum[3] - n * t.m4) / std::sqrt(n * (t.m8 - t.m4 * t.m4));
+  checks.push_back({name, "mean",     format_stat("z", z1), normal_p(z1)});
+  checks.push_back({name, "variance", format_stat("z", z2), normal_p(z2)});
+  checks.push_back({name, "skewness", format_stat("z", z3), normal_p(z3)});
+  checks.push_back({name, "kurtosis", format_stat("z", z4), normal_p(z4)});
+
+  // the fine bins are joined into bins of about equal probability for
+  // the chi-square test; the distance of the KS test is taken at the
+  // upper edges of the fine bins
+  const double width = (t.hi - t.lo) / fine_bins;
+  double chi2 = 0, ks = 0;
+  double observed = 0, expected = 0, cum_observed = 0;
+  double prev_cdf = 0;
+  std::size_t num_bins = 0;
+  for (std::size_t i = 0; i < fine_bins + 2; i++) {
+    const double edge = (i == fine_bins + 1) ? HUGE_VAL : t.lo + i * width;
+    const double cdf  = (i == fine_bins + 1) ? 1. : t.cdf(edge);
+    observed     += a.hist[i];
+    expected     += n * (cdf - prev_cdf);
+    cum_observed += a.hist[i];
+    prev_cdf      = cdf;
+    ks = std::max(ks, std::abs(cum_observed / n - cdf));
+    if (expected >= n / chi_squared_bins or i == fine_bins + 1) {
+      if (expected > 0) {
+        chi2 += (observed - expected) * (observed - expected) / expected;
+        num_bins++;
+      } else if (observed > 0) {
+        chi2 = HUGE_VAL;
+      }
+      observed = expected = 0;
+    }
+  }
+  checks.push_back({name, "chi-square",
+                    format_stat("chi2", chi2) + " df " + std::to_string(num_bins - 1),
+                    chi_squared_p(chi2, num_bins - 1)});
+  checks.push_back({name, "kolmogorov-smirnov", format_stat("D", ks), kolmogorov_p(ks, n)});
+
+  // correlations
+  std::vector<double>      z_lag;
+  std::vector<std::string> lag_labels;
+  for (std::size_t l = 0; l < s.lags.size(); l++) {
+    if (a.lag_count[l] > 0) {
+      z_lag.push_back(a.lag_sum[l] / std::sqrt(a.lag_count[l]));
+      lag_labels.push_back("at lag " + std::to_string(s.lags[l]));
+    }
+  }
+  add_correlation_checks(checks, name, "autocorrelation", z_lag, lag_labels);
+  std::vector<double>      z_cross;
+  std::vector<std::string> pair_labels;
+  for (std::size_t p = 0; p < a.cross_sum.size(); p++) {
+    z_cross.push_back(a.cross_sum[p] / std::sqrt(a.cross_count[p]));
+    pair_labels.push_back("at pair " + std::to_string(p));
+  }
+  add_correlation_checks(checks, name, "cross-stream", z_cross, pair_labels);
+  return;
+}
+
+// kolmogorov-smirnov test of samples against the distribution function
+// cdf, the samples being sorted in place
+template <typename Cdf>
+check
+make_ks_check(const std::string& test, std::vector<double>& x, Cdf cdf)
+{
+  std::sort(x.begin(), x.end());
+  const double n = x.size();
+  double ks = 0;
+  for (std::size_t i = 0; i < x.size(); i++) {
+    const double f = cdf(x[i]);
+    ks = std::max(ks, std::max((i + 1) / n - f, f - i / n));
+  }
+  return {"rotation", test, format_stat("D", ks), kolmogorov_p(ks, n)};
+}
+
+// the rotation matrices of the source Rotation are drawn by uniform
+// variates of std::mt19937_64 and doubled, as the sources halve them;
+// under the Haar measure, the rotation angle t has the distribution
+// function (t - sin t) / pi, and the image of the z axis is uniform on
+// the sphere, so that its z component is uniform in [-1,1] and its
+// azimuth in [-pi,pi)
+template <typename Rotation>
+void
+add_rotation_checks(std::vector<check>& checks, const settings& s)
+{
+  if (not Rotation::uniform_over_rotations or s.rotations == 0) {
+    return;
+  }
+  std::mt19937_64 engine(s.seed);
+  std::uniform_real_distribution<double> unif(0., 1.);
+  auto uniform = [&]() { return unif(engine); };
+  std::vector<double> angle(s.rotations), cosine(s.rotations), azimuth(s.rotations);
+  for (std::size_t k = 0; k < s.rotations; k++) {
+    md::rotation_matrix R;
+    Rotation::draw(R, uniform);
+    const double trace = 2. * (R.xx + R.yy + R.zz);
+    angle[k]   = std::acos(std::min(1., std::max(-1., 0.5 * (trace - 1.))));
+    cosine[k]  = 2. * R.zz;
+    azimuth[k] = std::atan2(R.yz, R.xz);
+  }
+  checks.push_back(make_ks_check("angle", angle, [](double t) {
+    return (t - std::sin(t)) / M_PI;
+  }));
+  checks.push_back(make_ks_check("z image cosine", cosine, [](double c) {
+    return 0.5 * (c + 1.);
+  }));
+  checks.push_back(make_ks_check("z image azimuth", azimuth, [](double a) {
+    return 0.5 * (a / M_PI + 1.);
+  }));
+  return;
+}
+
+// runs the checks of the generator Rng and of its rotation source
+template <typename Rng>
+void
+run_generator(const settings& s, std::vector<accumulator>& accs, std::vector<check>& rotation_checks)
+{
+  accs = run_checks<Rng>(s);
+  add_rotation_checks<typename Rng::rotation_source_type>(rotation_checks, s);
+  return;
+}
+
+// command line
+// ------------
+
+void
+usage(std::ostream& out)
+{
+  out <<
+    "usage: quality_rng [option=value ...]\n"
+    "  --rng=NAME        generator: molecular_dice, molecular_dice_float,\n"
+    "                    molecular_dice_interleaved, molecular_dice_soa,\n"
+    "                    molecular_dice_tiled, molecular_dice_quaternion,\n"
+    "                    molecular_dice_fixed32, molecular_dice_fixed64\n"
+    "  --api=NAME        scalar or bulk calls (default bulk)\n"
+    "  --start=NAME      construction of the generators: equilibriate,\n"
+    "                    fast for fast_start, or template for copies of one\n"
+    "                    template generator (default equilibriate)\n"
+    "  --dist=LIST       distributions: uniform, normal, exponential\n"
+    "  --samples=N       variates per stream (default 67108864)\n"
+    "  --streams=N       number of streams (default 8)\n"
+    "  --group=N         streams per group for cross-stream tests (default 4)\n"
+    "  --particles=N     number of particles (default 131072)\n"
+    "  --rotations=N     rotation matrices of the rotation test, 0 to skip\n"
+    "                    it (default 4194304)\n"
+    "  --threads=N       threads, 0 for all cores (default 0)\n"
+    "  --seed=N          base seed (default 1234)\n"
+    "  --alpha=F         p-value below which a test fails (default 1e-4)\n"
+    "  --lags=LIST       lags of the autocorrelation test\n"
+    "LIST is comma-separated. The exit status is 0 if all tests pass.\n";
+  return;
+}
+
+std::vector<std::string>
+split_list(const std::string& list)
+{
+  std::vector<std::string> items;
+  std::stringstream ss(list);
+  std::string item;
+  while (std::getline(ss, item, ',')) {
+    if (not item.empty()) {
+      items.push_back(item);
+    }
+  }
+  return items;
+}
+
+settings
+parse_settings(const int argc, char** argv)
+{
+  settings s;
+  for (int i = 1; i < argc; i++) {
+    const std::string arg(argv[i]);
+    const std::size_t eq = arg.find('=');
+    if (arg.compare(0, 2, "--") != 0 or eq == std::string::npos) {
+      throw std::invalid_argument("malformed option " + arg);
+    }
+    const std::string key   = arg.substr(2, eq - 2);
+    const std::string value = arg.substr(eq + 1);
+    if (key == "rng") {
+      s.rng = value;
+    } else if (key == "api") {
+      s.api = value;
+    } else if (key == "start") {
+      s.start = value;
+    } else if (key == "dist") {
+      s.dists.clear();
+      for (const std::string& item : split_list(value)) {
+        const std::size_t k = std::find(dist_names.begin(), dist_names.end(), item) - dist_names.begin();
+        if (k == dist_names.size()) {
+          throw std::invalid_argument("unknown distribution " + item);
+        }
+        s.dists.push_back(static_cast<dist>(k));
+      }
+    } else if (key == "samples") {
+      s.samples = static_cast<std::size_t>(std::stod(value));
+    } else if (key == "streams") {
+      s.streams = std::stoul(value);
+    } else if (key == "group") {
+      s.group = std::stoul(value);
+    } else if (key == "particles") {
+      s.particles = std::stoul(value);
+    } else if (key == "rotations") {
+      s.rotations = static_cast<std::size_t>(std::stod(value));
+    } else if (key == "threads") {
+      s.threads = std::stoul(value);
+    } else if (key == "seed") {
+      s.seed = std::stoul(value);
+    } else if (key == "alpha") {
+      s.alpha = std::stod(value);
+    } else if (key == "lags") {
+      s.lags.clear();
+      for (const std::string& item : split_list(value)) {
+        s.lags.push_back(std::stoul(item));
+      }
+    } else {
+      throw std::invalid_argument("unknown option " + arg);
+    }
+  }
+
+  if (s.samples == 0 or s.streams == 0 or s.group == 0 or s.dists.empty()) {
+    throw std::invalid_argument("use non-zero samples, streams and group size, "
+                                "and at least one distribution");
+  }
+  if (s.lags.empty() or *std::min_element(s.lags.begin(), s.lags.end()) == 0) {
+    throw std::invalid_argument("use at least one lag, all lags being non-zero");
+  }
+  if (s.api != "scalar" and s.api != "bulk") {
+    throw std::invalid_argument("unknown API " + s.api);
+  }
+  if (s.start != "equilibriate" and s.start != "fast" and s.start != "template") {
+    throw std::invalid_argument("unknown construction " + s.start);
+  }
+  return s;
+}
+
+int
+main(int argc, char** argv)
+{
+  settings s;
+  if (argc > 1 and std::string(argv[1]) == "--help") {
+    usage(std::cout);
+    return 0;
+  }
+  try {
+    s = parse_settings(argc, argv);
+  } catch (const std::exception& e) {
+    std::cerr << e.what() << "\n";
+    usage(std::cerr);
+    return 1;
+  }
+
+  const auto start = std::chrono::steady_clock::now();
+  std::vector<accumulator> accs;
+  std::vector<check>       rotation_checks;
+  if (s.rng == "molecular_dice") {
+    run_generator<md::rng>(s, accs, rotation_checks);
+  } else if (s.rng == "molecular_dice_float") {
+    run_generator<md::rng_float>(s, accs, rotation_checks);
+  } else if (s.rng == "molecular_dice_interleaved") {
+    run_generator<md::basic_rng<md::basic_rng_state<md::interleaved_layout>>>(s, accs, rotation_checks);
+  } else if (s.rng == "molecular_dice_soa") {
+    run_generator<md::basic_rng<md::basic_rng_state<md::soa_layout>>>(s, accs, rotation_checks);
+  } else if (s.rng == "molecular_dice_tiled") {
+    run_generator<md::rng_tiled>(s, accs, rotation_checks);
+  } else if (s.rng == "molecular_dice_quaternion") {
+    run_generator<md::rng_quaternion>(s, accs, rotation_checks);
+  } else if (s.rng == "molecular_dice_fixed32") {
+    run_generator<md::rng_fixed32>(s, accs, rotation_checks);
+  } else if (s.rng == "molecular_dice_fixed64") {
+    run_generator<md::rng_fixed64>(s, accs, rotation_checks);
+  } else {
+    std::cerr << "unknown generator " << s.rng << "\n";
+    usage(std::cerr);
+    return 1;
+  }
+  const auto end = std::chrono::steady_clock::now();
+  const double seconds = std::chrono::duration<double>(end - start).count();
+
+  std::vector<check> checks;
+  for (std::size_t d = 0; d < s.dists.size(); d++) {
+    add_checks(checks, s, s.dists[d], accs[d]);
+  }
+  checks.insert(checks.end(), rotation_checks.begin(), rotation_checks.end());
+
+  const double variates = static_cast<double>(s.samples) * s.streams * s.dists.size();
+  std::cout << "generator " << s.rng << " (" << s.api << ", " << s.start << "), "
+            << s.streams << " streams of " << s.samples << " variates, "
+            << s.particles << " particles\n";
+  std::cout << std::setprecision(3) << variates << " variates in " << seconds
+            << " s (" << variates / seconds << " variates/s), alpha " << s.alpha << "\n\n";
+
+  bool passed = true;
+  std::cout << std::left;
+  std::cout << std::setw(13) << "distribution" << std::setw(21) << "test"
+            << std::setw(34) << "statistic" << std::setw(12) << "p-value" << "result\n";
+  for (const check& c : checks) {
+    const bool pass = c.p >= s.alpha;
+    passed = passed and pass;
+    std::cout << std::setw(13) << c.dist << std::setw(21) << c.test
+              << std::setw(34) << c.statistic << std::setw(12) << std::setprecision(3) << c.p
+              << (pass ? "pass" : "FAIL") << "\n";
+  }
+  std::cout << "\n" << (passed ? "all tests passed" : "some tests FAILED") << "\n";
+
+  return passed ? 0 : 1;
+}